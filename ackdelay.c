@@ -0,0 +1,48 @@
+#include "emulator.h"
+#include "ackdelay.h"
+
+void ackdelay_init(struct ackdelay *d, int n)
+{
+  d->every = n > 1 ? n : 1;
+  d->held = 0;
+}
+
+void ackdelay_inorder(struct ackdelay *d, struct pkt ack)
+{
+  if (d->every == 1) {
+    tolayer3(B, ack);
+    return;
+  }
+
+  /* the new ACK covers the one held back */
+  if (d->held > 0)
+    sim_stats()->acks_saved++;
+  d->ack = ack;
+  d->held++;
+
+  if (d->held == d->every) {
+    stoptimer(B);
+    d->held = 0;
+    tolayer3(B, ack);
+  }
+  else if (d->held == 1)
+    starttimer(B, ACKDELAY);
+}
+
+void ackdelay_now(struct ackdelay *d, struct pkt ack)
+{
+  if (d->held > 0) {
+    sim_stats()->acks_saved++;
+    stoptimer(B);
+    d->held = 0;
+  }
+  tolayer3(B, ack);
+}
+
+void ackdelay_timeout(struct ackdelay *d)
+{
+  if (d->held > 0) {
+    d->held = 0;
+    tolayer3(B, d->ack);
+  }
+}
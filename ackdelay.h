@@ -0,0 +1,43 @@
+/* ******************************************************************
+   Delayed ACKs at the receiver.
+
+   Instead of one ACK packet for every data packet, the receiver holds
+   the ACK of an in-order packet and sends only the latest one, after
+   every nth in-order packet or once ACKDELAY has passed since the
+   first ACK held, whichever comes first; the one ACK then stands for
+   all of them.  Any other ACK (a duplicate, or one for an out-of-order
+   or corrupted packet) goes out at once and replaces the held one, so
+   the ACKs the protocol depends on for loss recovery are not delayed.
+
+   This only works where the ACK sent covers the ones held back, as the
+   cumulative ACKs of GBN do; SR ACKs need their SACK payload for it.
+
+   A held ACK lengthens the round trip by up to ACKDELAY, which the fixed
+   timeout of 16 does not allow for, so delayed ACKs turn on the adaptive
+   timeout (-R 1) unless the configuration fixes it with -R 0.
+
+   Runs on B's timer (starttimer()), so B_timerinterrupt() must call
+   ackdelay_timeout().  Each ACK held back and never sent counts in the
+   run's acks_saved.
+**********************************************************************/
+
+#define ACKDELAY 10.0     /* the longest time a packet takes on the channel, so
+                             one sent right after another is still waited for */
+
+struct ackdelay {
+  int every;              /* in-order packets per ACK, 1 for no delay */
+  int held;               /* in-order packets received since the last ACK */
+  struct pkt ack;         /* the latest ACK held back */
+};
+
+/* an ACK for every nth in-order packet; n of 0 or 1 for every packet */
+extern void ackdelay_init(struct ackdelay *d, int n);
+
+/* an in-order packet was received: send ack, or hold it back */
+extern void ackdelay_inorder(struct ackdelay *d, struct pkt ack);
+
+/* send ack at once, in place of any ACK held back */
+extern void ackdelay_now(struct ackdelay *d, struct pkt ack);
+
+/* B's timer expired: send the ACK held back */
+extern void ackdelay_timeout(struct ackdelay *d);
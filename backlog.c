@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include "emulator.h"
+#include "backlog.h"
+
+void backlog_init(struct backlog *b, int size)
+{
+  b->msgs = size > 0 ? sim_alloc(size * sizeof(struct msg)) : NULL;
+  b->since = size > 0 ? sim_alloc(size * sizeof(double)) : NULL;
+  b->size = size;
+  b->first = 0;
+  b->count = 0;
+}
+
+int backlog_put(struct backlog *b, struct msg message)
+{
+  struct simstats *st = sim_stats();
+  int i;
+
+  if (b->count == b->size)
+    return 0;
+  i = (b->first + b->count) % b->size;
+  b->msgs[i] = message;
+  b->since[i] = sim_time();
+  b->count++;
+  if (b->count > st->backlog_peak)
+    st->backlog_peak = b->count;
+  return 1;
+}
+
+int backlog_get(struct backlog *b, struct msg *message)
+{
+  struct simstats *st = sim_stats();
+  double wait;
+
+  if (b->count == 0)
+    return 0;
+  *message = b->msgs[b->first];
+  wait = sim_time() - b->since[b->first];
+  st->backlog_queued++;
+  st->backlog_wait += wait;
+  if (wait > st->backlog_maxwait)
+    st->backlog_maxwait = wait;
+  b->first = (b->first + 1) % b->size;
+  b->count--;
+  return 1;
+}
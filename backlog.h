@@ -0,0 +1,29 @@
+/* ******************************************************************
+   Sender backlog: messages from layer 5 waiting for room in the window.
+
+   A ring buffer of a fixed number of messages, taken out in the order
+   they were put in.  Instead of turning a message away whenever its
+   window is full, a sender queues it here and sends it once ACKs have
+   made room; only a message that finds the backlog full is lost.
+
+   The backlog keeps the run's backlog statistics in sim_stats(): the
+   greatest depth, and the number of messages sent from the backlog and
+   the time they spent waiting in it.
+**********************************************************************/
+
+struct backlog {
+  struct msg *msgs;       /* ring of size messages */
+  double *since;          /* when each message was queued */
+  int size;               /* capacity, 0 for no backlog */
+  int first;              /* ring index of the oldest message */
+  int count;              /* messages queued */
+};
+
+/* a backlog of size messages, freed with the current simulation */
+extern void backlog_init(struct backlog *b, int size);
+
+/* queue message; returns 0 if the backlog is full */
+extern int backlog_put(struct backlog *b, struct msg message);
+
+/* take the oldest message into *message; returns 0 if there is none */
+extern int backlog_get(struct backlog *b, struct msg *message);
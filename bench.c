@@ -0,0 +1,260 @@
+/* ******************************************************************
+   Microbenchmarks for the emulator core and the protocols.
+
+   Measures
+   - ns per insert + pop-min on each pending-event queue, holding a
+     fixed number of events queued (the classic "hold" model)
+   - ns per tolayer3() call and per starttimer()/stoptimer() pair
+   - ns per byte for each packet checksum, from a packet's 28 bytes up
+     to 64 KB
+   - events per second and wall time per million messages for whole
+     simulations of each protocol over fixed seeds and loss rates, with
+     the adaptive timeout so that every run drains; a run stopped as
+     overloaded would time only part of its messages, and fails the
+     benchmark
+
+   and writes the results as one JSON object, so runs before and after
+   an engine change can be compared.  Anything the protocol prints
+   while it runs is discarded.
+
+   e.g.  emubench -n 100000 -o bench.json
+**********************************************************************/
+#define _POSIX_C_SOURCE 200809L   /* clock_gettime(), fdopen() */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "protocol.h"
+#include "evqueue.h"
+#include "evpool.h"
+#include "config.h"
+#include "checksum.h"
+#include "sim.h"
+
+#define HOLDOPS   1000000   /* insert + pop-min pairs per queue measurement */
+#define MICROOPS  100000    /* tolayer3() calls, timer pairs per batch */
+#define MICROREPS 10        /* batches, each in a fresh simulation */
+#define CKSUMBYTES 50000000 /* bytes checksummed per algorithm and length */
+
+static const double lossrates[] = { 0.0, 0.1, 0.2 };
+static const unsigned int seeds[] = { 1, 2, 3 };
+
+#define NLOSS  (int)(sizeof(lossrates) / sizeof(lossrates[0]))
+#define NSEEDS (int)(sizeof(seeds) / sizeof(seeds[0]))
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* cheap deterministic increments for the hold model */
+static unsigned int lcg(unsigned int *x)
+{
+  *x = *x * 1103515245u + 12345u;
+  return *x >> 16;
+}
+
+/********************* EVENT QUEUES *******************/
+
+static double benchhold(int kind, int nheld)
+{
+  struct evqueue q;
+  struct evpool pool;
+  struct event *e;
+  unsigned int x = 1;
+  double t0, t;
+  int i;
+
+  evq_init(&q, kind);
+  evpool_init(&pool);
+  for (i = 0; i < nheld; i++) {
+    e = evpool_get(&pool);
+    e->evtime = (lcg(&x) % 1000) / 100.0;
+    evq_insert(&q, e);
+  }
+  t0 = now();
+  for (i = 0; i < HOLDOPS; i++) {
+    e = evq_popmin(&q);
+    e->evtime += 1.0 + (lcg(&x) % 1000) / 100.0;
+    evq_insert(&q, e);
+  }
+  t = now() - t0;
+  evq_free(&q);
+  evpool_free(&pool);
+  return t * 1e9 / HOLDOPS;
+}
+
+/********************* EMULATOR CALLS *****************/
+
+static void calltolayer3(void *arg)
+{
+  struct pkt p;
+  int i;
+
+  (void)arg;
+  memset(&p, 0, sizeof(p));
+  for (i = 0; i < MICROOPS; i++) {
+    p.seqnum = i;
+    tolayer3(A, p);
+  }
+}
+
+static void calltimers(void *arg)
+{
+  int i;
+
+  (void)arg;
+  for (i = 0; i < MICROOPS; i++) {
+    starttimer(A, 16.0);
+    stoptimer(A);
+  }
+}
+
+/* ns per operation done by fn, each batch in a fresh simulation */
+static double benchcall(void (*fn)(void *))
+{
+  struct simconfig cfg;
+  struct sim *s;
+  double t0, t = 0.0;
+  int r;
+
+  config_defaults(&cfg);
+  for (r = 0; r < MICROREPS; r++) {
+    s = sim_create(&cfg);
+    t0 = now();
+    sim_call(s, fn, NULL);
+    t += now() - t0;
+    sim_destroy(s);
+  }
+  return t * 1e9 / ((double)MICROREPS * MICROOPS);
+}
+
+/********************* CHECKSUMS **********************/
+
+static volatile unsigned int cksumsink;   /* keeps the results live */
+
+/* ns per byte checksummed, over len bytes at a time */
+static double benchchecksum(int kind, size_t len)
+{
+  static unsigned char data[65536];
+  unsigned int x = 1, acc = 0;
+  long long r, reps = CKSUMBYTES / len;
+  double t0;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    data[i] = (unsigned char)lcg(&x);
+  t0 = now();
+  for (r = 0; r < reps; r++)
+    acc += checksum(kind, data, len);
+  cksumsink = acc;
+  return (now() - t0) * 1e9 / ((double)reps * len);
+}
+
+/********************* MAIN ***************************/
+
+int main(int argc, char **argv)
+{
+  static const int held[] = { 16, 1024 };
+  static const size_t cksumlens[] = { 28, 256, 1500, 65536 };
+  struct simconfig cfg;
+  struct sim *s;
+  FILE *fp;
+  const char *outname = NULL;
+  long long nmsgs = 100000, events, totevents, simulated, totsimulated;
+  double t0, t, tottime;
+  int i, j, k, p, first = 1;
+
+  for (i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      fprintf(stderr, "usage: %s [-n messages] [-o file]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (strcmp(argv[i], "-n") == 0 && atoll(argv[i + 1]) > 0)
+      nmsgs = atoll(argv[i + 1]);
+    else if (strcmp(argv[i], "-o") == 0)
+      outname = argv[i + 1];
+    else {
+      fprintf(stderr, "usage: %s [-n messages] [-o file]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* keep the real stdout for the results and silence the protocol */
+  fp = outname != NULL ? fopen(outname, "w") : fdopen(dup(STDOUT_FILENO), "w");
+  if (fp == NULL) {
+    perror(outname != NULL ? outname : "stdout");
+    return EXIT_FAILURE;
+  }
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    perror("/dev/null");
+    return EXIT_FAILURE;
+  }
+
+  fprintf(fp, "{\"hold_ns\": {");
+  for (k = EVQ_LIST; k <= EVQ_CALENDAR; k++)
+    for (j = 0; j < (int)(sizeof(held) / sizeof(held[0])); j++) {
+      fprintf(fp, "%s\"%s_%d\": %.1f", first ? "" : ", ", evq_name(k), held[j],
+              benchhold(k, held[j]));
+      first = 0;
+    }
+  fprintf(fp, "},\n \"tolayer3_ns\": %.1f,\n", benchcall(calltolayer3));
+  fprintf(fp, " \"timer_start_stop_ns\": %.1f,\n", benchcall(calltimers));
+
+  fprintf(fp, " \"checksum_ns_per_byte\": {");
+  first = 1;
+  for (k = 0; k < CKSUM_COUNT; k++)
+    for (j = 0; j < (int)(sizeof(cksumlens) / sizeof(cksumlens[0])); j++) {
+      fprintf(fp, "%s\"%s_%zu\": %.3f", first ? "" : ", ", checksum_name(k), cksumlens[j],
+              benchchecksum(k, cksumlens[j]));
+      first = 0;
+    }
+  fprintf(fp, "},\n \"crc32c_hw\": %d,\n", checksum_crc32c_hw());
+
+  fprintf(fp, " \"protocols\": [");
+  for (p = 0; protocols[p] != NULL; p++) {
+    fprintf(fp, "%s\n  {\"protocol\": \"%s\", \"runs\": [\n", p == 0 ? "" : ",",
+            protocols[p]->name);
+    totevents = 0;
+    totsimulated = 0;
+    tottime = 0.0;
+    for (i = 0; i < NLOSS; i++)
+      for (j = 0; j < NSEEDS; j++) {
+        config_defaults(&cfg);
+        cfg.protocol = p;
+        cfg.nsimmax = nmsgs;
+        cfg.lossprob = lossrates[i];
+        cfg.seed = seeds[j];
+        cfg.adaptiverto = 1;
+        s = sim_create(&cfg);
+        t0 = now();
+        sim_run(s);
+        t = now() - t0;
+        events = sim_events(s);
+        simulated = sim_getstats(s)->nsim;
+        if (sim_getstats(s)->overloaded) {
+          fprintf(stderr, "%s, loss %g, seed %u: run stopped as overloaded after %lld messages\n",
+                  protocols[p]->name, cfg.lossprob, cfg.seed, simulated);
+          return EXIT_FAILURE;
+        }
+        sim_destroy(s);
+        totevents += events;
+        totsimulated += simulated;
+        tottime += t;
+        fprintf(fp, "    {\"loss\": %g, \"seed\": %u, \"messages\": %lld, \"events\": %lld, "
+                "\"seconds\": %.6f, \"events_per_sec\": %.0f, \"sec_per_million_msgs\": %.6f}%s\n",
+                cfg.lossprob, cfg.seed, simulated, events, t, events / t, t * 1e6 / simulated,
+                i == NLOSS - 1 && j == NSEEDS - 1 ? "" : ",");
+      }
+    fprintf(fp, "   ],\n   \"events_per_sec\": %.0f, \"sec_per_million_msgs\": %.6f}",
+            totevents / tottime, tottime * 1e6 / totsimulated);
+  }
+  fprintf(fp, "\n ]}\n");
+  fclose(fp);
+  return EXIT_SUCCESS;
+}
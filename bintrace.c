@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "bintrace.h"
+
+struct bintrace *bt_open(const char *path)
+{
+  struct bintrace *bt;
+  struct btheader h;
+
+  bt = malloc(sizeof(struct bintrace));
+  if (bt == NULL) {
+    printf("memory allocation for binary trace failed.");
+    exit(EXIT_FAILURE);
+  }
+  bt->buf = malloc(BT_BUFRECS * sizeof(struct btrecord));
+  if (bt->buf == NULL) {
+    printf("memory allocation for binary trace failed.");
+    exit(EXIT_FAILURE);
+  }
+  bt->fp = fopen(path, "wb");
+  if (bt->fp == NULL) {
+    free(bt->buf);
+    free(bt);
+    return NULL;
+  }
+  bt->n = 0;
+  bt->nrecs = 0;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, BT_MAGIC, sizeof(h.magic));
+  h.version = BT_VERSION;
+  h.recsize = sizeof(struct btrecord);
+  fwrite(&h, sizeof(h), 1, bt->fp);
+  return bt;
+}
+
+void bt_flush(struct bintrace *bt)
+{
+  if (bt->n > 0 && fwrite(bt->buf, sizeof(struct btrecord), bt->n, bt->fp) != (size_t)bt->n) {
+    printf("write to binary trace failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  bt->nrecs += bt->n;
+  bt->n = 0;
+}
+
+void bt_close(struct bintrace *bt)
+{
+  bt_flush(bt);
+  if (fclose(bt->fp) != 0) {
+    printf("write to binary trace failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  free(bt->buf);
+  free(bt);
+}
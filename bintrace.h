@@ -0,0 +1,72 @@
+/* ******************************************************************
+   Binary event trace.
+
+   A much cheaper alternative to the printf trace for long runs: every
+   message, packet send and arrival, delivery and timeout becomes one
+   fixed-size record appended to a file through a large write buffer.
+   The file is a struct btheader followed by the records in simulation
+   order, in the byte order of the machine that wrote it.  tracetool
+   maps the file and analyses it without re-running the simulation.
+**********************************************************************/
+
+#include <stdio.h>
+
+#define BT_MAGIC   "RDTTRACE"
+#define BT_VERSION 1
+
+/* record types */
+#define BT_MESSAGE 1      /* message from layer 5 handed to entity */
+#define BT_SEND    2      /* packet passed by entity to layer 3 */
+#define BT_ARRIVE  3      /* packet handed by layer 3 to entity */
+#define BT_DELIVER 4      /* data passed by entity up to layer 5 */
+#define BT_TIMEOUT 5      /* timer interrupt at entity; seq holds its tag */
+
+/* record flags */
+#define BTF_LOST       0x01   /* BT_SEND: dropped by the medium */
+#define BTF_CORRUPT    0x02   /* BT_SEND, BT_ARRIVE: corrupted by the medium */
+#define BTF_RETRANSMIT 0x04   /* BT_SEND: counted by the protocol as a resend */
+#define BTF_REFUSED    0x08   /* BT_MESSAGE: dropped because the window or the
+                                 segment queue was full */
+
+struct btheader {
+  char magic[8];          /* BT_MAGIC, not NUL terminated */
+  unsigned int version;   /* BT_VERSION */
+  unsigned int recsize;   /* sizeof(struct btrecord) */
+};
+
+struct btrecord {
+  double time;            /* simulation time */
+  long long pktid;        /* BT_SEND/BT_ARRIVE: packet number, from 1; else 0 */
+  int seq;                /* seqnum of the packet, or as noted above */
+  int ack;                /* acknum of the packet */
+  unsigned char type;     /* one of the BT_ types above */
+  unsigned char entity;   /* A or B */
+  unsigned short flags;   /* BTF_ flags */
+  int reserved;           /* zero; pads the record to 32 bytes */
+};
+
+#define BT_BUFRECS 4096   /* records buffered between writes */
+
+struct bintrace {
+  FILE *fp;
+  struct btrecord *buf;
+  int n;                  /* records in buf */
+  long long nrecs;        /* records written so far */
+};
+
+/* create path and write the header; returns NULL if the file cannot be
+   created */
+extern struct bintrace *bt_open(const char *path);
+
+/* write out the buffered records */
+extern void bt_flush(struct bintrace *bt);
+
+static inline void bt_write(struct bintrace *bt, const struct btrecord *r)
+{
+  bt->buf[bt->n++] = *r;
+  if (bt->n == BT_BUFRECS)
+    bt_flush(bt);
+}
+
+/* write out the buffer and close the file */
+extern void bt_close(struct bintrace *bt);
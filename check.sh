@@ -0,0 +1,76 @@
+#!/bin/sh
+# ******************************************************************
+# Regression checks, run by "make check" from the build directory.
+#
+# 1. The classic scenarios, run with -g rand so that the random draws
+#    are those of the C library rand() the original emulator used, must
+#    give the results in check.expected.  Of these only two GBN runs
+#    match the original emulator exactly:
+#    - GBN with loss and corruption 0.2 reports 4404 resends where the
+#      float clock of the original gave 4398: near-equal event times
+#      that float rounding merged are now kept apart.
+#    - All three SR runs differ.  The original resent one packet per
+#      expiry of a single timer; SR now gives each packet its own timer
+#      and by default estimates the timeout from measured round trips.
+#      The original delivered 222, 854 and 35 messages, in the order
+#      of check.expected; SR now delivers 554, 792 and 78.
+# 2. A run whose clock goes well past 2^24, where a float clock can no
+#    longer tell the channel delays apart, must write its binary trace
+#    in nondecreasing time order.
+# 3. A deep backlog under the fixed timeout, which keeps resending
+#    packets still queued on the channel, must stop as overloaded
+#    instead of running without end; with -R 1 the same scenario must
+#    deliver every message.  Without a backlog the window empties and
+#    the channel drains by itself, so a run must never be stopped.
+# ******************************************************************
+
+tmp=${TMPDIR:-/tmp}/rdtcheck.$$
+trap 'rm -f $tmp.out $tmp.trace $tmp.sum' EXIT
+fail=0
+
+scenario() {
+  echo "== $*"
+  ./emulator -g rand "$@" | grep -A6 'after attempting' | grep -v '^(note'
+}
+
+for p in gbn sr; do
+  scenario -p $p -n 1000 -l 0.2 -c 0.2 -d 0 -m 10
+  scenario -p $p -n 1000 -m 5
+  scenario -p $p -n 500 -l 0.3 -c 0.1 -d 2 -m 5
+done > $tmp.out
+if diff -u check.expected $tmp.out; then
+  echo "ok   reference scenarios"
+else
+  echo "FAIL reference scenarios"
+  fail=1
+fi
+
+./emulator -p gbn -n 50000 -m 1000 -l 0.1 -b $tmp.trace -q &&
+  ./tracetool $tmp.trace > $tmp.sum
+if awk 'NR == 1 { t = $7; n = $8 } END { exit !(t + 0 > 16777216 && n == "0") }' \
+     FS='[ ,]+' $tmp.sum; then
+  echo "ok   event time order past 2^24"
+else
+  echo "FAIL event time order past 2^24"
+  head -1 $tmp.sum
+  fail=1
+fi
+
+overload="-p gbn -n 500 -m 50 -M 100 -R 0 -B 100000 -w 3 -S 4 -q -o /dev/stdout"
+if timeout 60 ./emulator $overload > $tmp.out &&
+     awk -F, 'NR == 1 { for (i = 1; i <= NF; i++) col[$i] = i }
+              NR == 2 { exit !($col["overloaded"] == 1) }' $tmp.out &&
+   timeout 60 ./emulator $overload -R 1 > $tmp.out &&
+     awk -F, 'NR == 1 { for (i = 1; i <= NF; i++) col[$i] = i }
+              NR == 2 { exit !($col["overloaded"] == 0 && $col["messages_delivered"] == 500) }' $tmp.out &&
+   timeout 60 ./emulator -p gbn -n 20000 -q -o /dev/stdout > $tmp.out &&
+     awk -F, 'NR == 1 { for (i = 1; i <= NF; i++) col[$i] = i }
+              NR == 2 { exit !($col["overloaded"] == 0 && $col["msgs_sent"] == 20000) }' $tmp.out
+then
+  echo "ok   overloaded backlog stops"
+else
+  echo "FAIL overloaded backlog stops"
+  fail=1
+fi
+
+exit $fail
@@ -0,0 +1,197 @@
+#include <stddef.h>
+#include <string.h>
+#include "emulator.h"
+#include "checksum.h"
+#include "crc32c.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_HW 1
+#include <nmmintrin.h>
+#else
+#define CRC32C_HW 0
+#endif
+
+static const char *const names[CKSUM_COUNT] = { "sum", "inet", "fletcher", "adler", "crc32c" };
+
+static unsigned int sum(const char *p, size_t len)
+{
+  unsigned int s = 0;
+  size_t i;
+
+  /* plain char, as the protocols summed their payloads */
+  for (i = 0; i < len; i++)
+    s += (unsigned int)p[i];
+  return s;
+}
+
+static unsigned int inet(const unsigned char *p, size_t len)
+{
+  unsigned long long s = 0;
+  unsigned int w;
+  unsigned short h;
+  unsigned char last[2];
+
+  /* 32-bit words into a 64-bit sum; the ones' complement sum is the same
+     in either byte order, and the carries are folded back in at the end */
+  for (; len >= 4; p += 4, len -= 4) {
+    memcpy(&w, p, 4);
+    s += w;
+  }
+  if (len >= 2) {
+    memcpy(&h, p, 2);
+    s += h;
+    p += 2;
+    len -= 2;
+  }
+  if (len > 0) {
+    last[0] = *p;
+    last[1] = 0;
+    memcpy(&h, last, 2);
+    s += h;
+  }
+  while (s >> 16)
+    s = (s & 0xffff) + (s >> 16);
+  return ~(unsigned int)s & 0xffff;
+}
+
+static unsigned int fletcher(const unsigned char *p, size_t len)
+{
+  unsigned int a = 0, b = 0;
+  size_t n;
+
+  /* little-endian 16-bit words; 360 of them is the most that can be
+     summed before b overflows, and an odd last byte is padded with a zero */
+  while (len > 1) {
+    n = len / 2 < 360 ? len / 2 : 360;
+    len -= 2 * n;
+    for (; n > 0; n--, p += 2) {
+      a += p[0] | (unsigned int)p[1] << 8;
+      b += a;
+    }
+    a %= 65535;
+    b %= 65535;
+  }
+  if (len > 0) {
+    a = (a + p[0]) % 65535;
+    b = (b + a) % 65535;
+  }
+  return b << 16 | a;
+}
+
+static unsigned int adler(const unsigned char *p, size_t len)
+{
+  unsigned int a = 1, b = 0;
+  size_t n;
+
+  /* 5552 bytes is the most that can be summed before b overflows; four
+     at a time, b gaining four times a and each byte by its place */
+  while (len > 0) {
+    n = len < 5552 ? len : 5552;
+    len -= n;
+    for (; n >= 4; n -= 4, p += 4) {
+      b += 4 * a + 4 * p[0] + 3 * p[1] + 2 * p[2] + p[3];
+      a += p[0] + p[1] + p[2] + p[3];
+    }
+    for (; n > 0; n--, p++) {
+      a += *p;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return b << 16 | a;
+}
+
+static unsigned int crc32c_sw(const unsigned char *p, size_t len)
+{
+  unsigned int crc = 0xffffffff;
+  unsigned int lo, hi;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    lo = crc ^ ((unsigned int)p[0] | (unsigned int)p[1] << 8 | (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24);
+    hi = (unsigned int)p[4] | (unsigned int)p[5] << 8 | (unsigned int)p[6] << 16 | (unsigned int)p[7] << 24;
+    crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+          crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+          crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff] ^
+          crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+  }
+  for (; len > 0; p++, len--)
+    crc = crc32c_table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+#if CRC32C_HW
+__attribute__((target("sse4.2")))
+static unsigned int crc32c_hw(const unsigned char *p, size_t len)
+{
+  unsigned long long crc = 0xffffffff;
+  unsigned long long w;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&w, p, 8);
+    crc = _mm_crc32_u64(crc, w);
+  }
+  for (; len > 0; p++, len--)
+    crc = _mm_crc32_u8((unsigned int)crc, *p);
+  return ~(unsigned int)crc;
+}
+#endif
+
+int checksum_crc32c_hw(void)
+{
+#if CRC32C_HW
+  return __builtin_cpu_supports("sse4.2") != 0;
+#else
+  return 0;
+#endif
+}
+
+unsigned int checksum(int kind, const void *data, size_t len)
+{
+  switch (kind) {
+  case CKSUM_INET:
+    return inet(data, len);
+  case CKSUM_FLETCHER:
+    return fletcher(data, len);
+  case CKSUM_ADLER:
+    return adler(data, len);
+  case CKSUM_CRC32C:
+#if CRC32C_HW
+    if (__builtin_cpu_supports("sse4.2"))
+      return crc32c_hw(data, len);
+#endif
+    return crc32c_sw(data, len);
+  default:
+    return sum(data, len);
+  }
+}
+
+int checksum_pkt(int kind, const struct pkt *packet)
+{
+  unsigned char buf[2 * sizeof(int) + sizeof(packet->payload)];
+
+  /* the header fields are summed as numbers, not bytes, as they always were */
+  if (kind == CKSUM_SUM)
+    return (int)((unsigned int)packet->seqnum + (unsigned int)packet->acknum +
+                 sum(packet->payload, sizeof(packet->payload)));
+
+  memcpy(buf, &packet->seqnum, sizeof(int));
+  memcpy(buf + sizeof(int), &packet->acknum, sizeof(int));
+  memcpy(buf + 2 * sizeof(int), packet->payload, sizeof(packet->payload));
+  return (int)checksum(kind, buf, sizeof(buf));
+}
+
+const char *checksum_name(int kind)
+{
+  return kind >= 0 && kind < CKSUM_COUNT ? names[kind] : "?";
+}
+
+int checksum_find(const char *name)
+{
+  int k;
+
+  for (k = 0; k < CKSUM_COUNT; k++)
+    if (strcmp(name, names[k]) == 0)
+      return k;
+  return -1;
+}
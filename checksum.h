@@ -0,0 +1,44 @@
+/* ******************************************************************
+   Packet checksums.
+
+   Each algorithm takes data of any length by pointer:
+   - CKSUM_SUM:      the sum of the bytes the protocols always used; it
+                     misses any reordering of the bytes and most pairs
+                     of errors that cancel out
+   - CKSUM_INET:     the 16-bit ones' complement sum of the Internet
+                     protocols (RFC 1071), summed a 32-bit word at a time
+   - CKSUM_FLETCHER: Fletcher-32 over 16-bit words; its second sum also
+                     depends on where each word is, so it catches swaps
+   - CKSUM_ADLER:    Adler-32 (RFC 1950), a byte-wise Fletcher sum modulo
+                     the prime 65521
+   - CKSUM_CRC32C:   CRC-32C (Castagnoli, RFC 3720), which detects every
+                     burst of up to 32 bits; eight bytes per step, with
+                     the SSE4.2 crc32 instruction where the CPU has it and
+                     table lookups (slicing-by-8) otherwise
+
+   checksum_pkt() applies one of them to the header and payload of a
+   packet.  With CKSUM_SUM it gives exactly the checksum of earlier
+   versions, so the protocols' default behaviour is unchanged.
+**********************************************************************/
+
+#define CKSUM_SUM       0
+#define CKSUM_INET      1
+#define CKSUM_FLETCHER  2
+#define CKSUM_ADLER     3
+#define CKSUM_CRC32C    4
+#define CKSUM_COUNT     5
+
+/* checksum of len bytes at data */
+extern unsigned int checksum(int kind, const void *data, size_t len);
+
+/* checksum of the packet's sequence and ACK numbers and payload, for
+   its checksum field */
+extern int checksum_pkt(int kind, const struct pkt *packet);
+
+extern const char *checksum_name(int kind);
+
+/* CKSUM_ constant of the named algorithm, or -1 */
+extern int checksum_find(const char *name);
+
+/* true if CKSUM_CRC32C runs on the CPU's crc32 instruction */
+extern int checksum_crc32c_hw(void);
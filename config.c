@@ -0,0 +1,308 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "emulator.h"
+#include "protocol.h"
+#include "config.h"
+#include "window.h"
+#include "rng.h"
+#include "checksum.h"
+#include "sar.h"
+
+void config_defaults(struct simconfig *cfg)
+{
+  strcpy(cfg->label, "run");
+  cfg->nsimmax = 1000;
+  cfg->lossprob = 0.0;
+  cfg->corruptprob = 0.0;
+  cfg->corruptdirection = 2;
+  cfg->lambda = 10.0;
+  cfg->trace = 0;
+  cfg->windowsize = 0;
+  cfg->seqspace = 0;
+  cfg->dupthresh = 0;
+  cfg->adaptiverto = -1;
+  cfg->congestion = 0;
+  cfg->backlog = 0;
+  cfg->sack = 0;
+  cfg->ackevery = 1;
+  cfg->checksum = CKSUM_SUM;
+  cfg->msgsize = 0;
+  cfg->msgmax = 0;
+  cfg->mtu = 0;
+  cfg->seed = 9999;
+  cfg->rng = RNG_XOSHIRO;
+  cfg->antithetic = 0;
+  cfg->tracefile[0] = '\0';
+  cfg->protocol = 0;
+}
+
+static int parseint(const char *arg, int *value)
+{
+  char *end;
+  long v;
+
+  errno = 0;
+  v = strtol(arg, &end, 10);
+  if (end == arg || *end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX)
+    return -1;
+  *value = (int)v;
+  return 0;
+}
+
+static int parselong(const char *arg, long long *value)
+{
+  char *end;
+  long long v;
+
+  errno = 0;
+  v = strtoll(arg, &end, 10);
+  if (end == arg || *end != '\0' || errno == ERANGE)
+    return -1;
+  *value = v;
+  return 0;
+}
+
+/* "n" for n to n, or "min-max" */
+static int parsesizes(const char *arg, long long *min, long long *max)
+{
+  char buf[64];
+  const char *dash = strchr(arg, '-');
+
+  if (dash == NULL) {
+    if (parselong(arg, min) != 0)
+      return -1;
+    *max = *min;
+    return 0;
+  }
+  if ((size_t)(dash - arg) >= sizeof(buf))
+    return -1;
+  memcpy(buf, arg, dash - arg);
+  buf[dash - arg] = '\0';
+  if (parselong(buf, min) != 0 || parselong(dash + 1, max) != 0)
+    return -1;
+  return 0;
+}
+
+static int parsefloat(const char *arg, float *value)
+{
+  char *end;
+  double v = strtod(arg, &end);
+
+  if (end == arg || *end != '\0')
+    return -1;
+  *value = (float)v;
+  return 0;
+}
+
+int config_option(struct simconfig *cfg, const char *opt, const char *arg)
+{
+  long long seed;
+  int err, proto;
+
+  if (opt[0] != '-' || opt[1] == '\0' || opt[2] != '\0')
+    return 0;
+  if (strchr("LnlcdmtwSDRCBKAeMUsgabp", opt[1]) == NULL)
+    return 0;
+  if (arg == NULL)
+    return -1;
+
+  switch (opt[1]) {
+  case 'L':
+    strncpy(cfg->label, arg, CONFIG_LABELSIZE - 1);
+    cfg->label[CONFIG_LABELSIZE - 1] = '\0';
+    err = 0;
+    break;
+  case 'n':
+    err = parselong(arg, &cfg->nsimmax);
+    break;
+  case 'l':
+    err = parsefloat(arg, &cfg->lossprob);
+    if (!(cfg->lossprob >= 0.0 && cfg->lossprob <= 1.0))
+      err = -1;
+    break;
+  case 'c':
+    err = parsefloat(arg, &cfg->corruptprob);
+    if (!(cfg->corruptprob >= 0.0 && cfg->corruptprob <= 1.0))
+      err = -1;
+    break;
+  case 'd':
+    err = parseint(arg, &cfg->corruptdirection);
+    if (cfg->corruptdirection < 0 || cfg->corruptdirection > 2)
+      err = -1;
+    break;
+  case 'm':
+    err = parsefloat(arg, &cfg->lambda);
+    if (cfg->lambda <= 0.0)
+      err = -1;
+    break;
+  case 'w':
+    err = parseint(arg, &cfg->windowsize);
+    if (cfg->windowsize < 0)
+      err = -1;
+    break;
+  case 'S':
+    err = parselong(arg, &cfg->seqspace);
+    if (cfg->seqspace < 0 || cfg->seqspace == 1 || cfg->seqspace > SEQSPACE32)
+      err = -1;
+    break;
+  case 'D':
+    err = parseint(arg, &cfg->dupthresh);
+    if (cfg->dupthresh < 0)
+      err = -1;
+    break;
+  case 'R':
+    err = parseint(arg, &cfg->adaptiverto);
+    if (cfg->adaptiverto < 0 || cfg->adaptiverto > 1)
+      err = -1;
+    break;
+  case 'C':
+    err = parseint(arg, &cfg->congestion);
+    if (cfg->congestion < 0 || cfg->congestion > 1)
+      err = -1;
+    break;
+  case 'B':
+    err = parseint(arg, &cfg->backlog);
+    if (cfg->backlog < 0)
+      err = -1;
+    break;
+  case 'K':
+    err = parseint(arg, &cfg->sack);
+    if (cfg->sack < 0 || cfg->sack > 1)
+      err = -1;
+    break;
+  case 'A':
+    err = parseint(arg, &cfg->ackevery);
+    if (cfg->ackevery < 0)
+      err = -1;
+    break;
+  case 'e':
+    cfg->checksum = checksum_find(arg);
+    err = cfg->checksum < 0 ? -1 : 0;
+    break;
+  case 'M':
+    err = parsesizes(arg, &cfg->msgsize, &cfg->msgmax);
+    if (!err && (cfg->msgsize < 0 || cfg->msgmax > SAR_MAXMSG || cfg->msgmax < cfg->msgsize
+                 || (cfg->msgmax > cfg->msgsize && cfg->msgsize == 0)))
+      err = -1;
+    break;
+  case 'U':
+    err = parseint(arg, &cfg->mtu);
+    if (cfg->mtu != 0 && (cfg->mtu <= SAR_HEADER || cfg->mtu > PAYLOADSIZE || cfg->mtu > SAR_MAXMTU))
+      err = -1;
+    break;
+  case 'p':
+    proto = protocol_find(arg);
+    err = proto < 0 ? -1 : 0;
+    if (!err)
+      cfg->protocol = proto;
+    break;
+  case 'b':
+    err = strlen(arg) < sizeof(cfg->tracefile) ? 0 : -1;
+    if (!err)
+      strcpy(cfg->tracefile, arg);
+    break;
+  case 'a':
+    err = parseint(arg, &cfg->antithetic);
+    if (cfg->antithetic < 0 || cfg->antithetic > 1)
+      err = -1;
+    break;
+  case 'g':
+    err = 0;
+    if (strcmp(arg, "xoshiro") == 0)
+      cfg->rng = RNG_XOSHIRO;
+    else if (strcmp(arg, "rand") == 0)
+      cfg->rng = RNG_COMPAT;
+    else
+      err = -1;
+    break;
+  case 's':
+    /* negative seeds wrap to unsigned, as they always have */
+    err = parselong(arg, &seed);
+    if (!err && (seed < INT_MIN || seed > UINT_MAX))
+      err = -1;
+    if (!err)
+      cfg->seed = (unsigned int)seed;
+    break;
+  default:
+    err = parseint(arg, &cfg->trace);
+    break;
+  }
+  return err ? -1 : 2;
+}
+
+int config_parseline(struct simconfig *cfg, char *line)
+{
+  char *argv[CONFIG_LINESIZE / 2];
+  char *tok, *hash;
+  int argc = 0, i, used;
+
+  hash = strchr(line, '#');
+  if (hash != NULL)
+    *hash = '\0';
+  for (tok = strtok(line, " \t\r\n"); tok != NULL; tok = strtok(NULL, " \t\r\n"))
+    argv[argc++] = tok;
+  if (argc == 0)
+    return 0;
+
+  for (i = 0; i < argc; i += used) {
+    used = config_option(cfg, argv[i], i + 1 < argc ? argv[i + 1] : NULL);
+    if (used <= 0) {
+      fprintf(stderr, "bad scenario option '%s'\n", argv[i]);
+      return -1;
+    }
+  }
+  return 1;
+}
+
+void config_usage(FILE *fp, const char *progname)
+{
+  fprintf(fp, "usage: %s [options]\n", progname);
+  fprintf(fp, "with no options the scenario is read interactively.\n\n");
+  fprintf(fp, "scenario options (also used on scenario file lines):\n");
+  fprintf(fp, "  -L label   name of the scenario in the results\n");
+  fprintf(fp, "  -p name    protocol: gbn (default) or sr\n");
+  fprintf(fp, "  -n count   number of messages to simulate\n");
+  fprintf(fp, "  -l prob    packet loss probability\n");
+  fprintf(fp, "  -c prob    packet corruption probability\n");
+  fprintf(fp, "  -d dir     loss/corruption direction: 0 A->B, 1 A<-B, 2 both\n");
+  fprintf(fp, "  -m time    average time between messages from layer 5\n");
+  fprintf(fp, "  -t level   TRACE level\n");
+  fprintf(fp, "  -b file    write a binary event trace to file (see tracetool)\n");
+  fprintf(fp, "  -w size    sender window size (default: the protocol's own)\n");
+  fprintf(fp, "  -S space   sequence numbers in use, up to 4294967296 (default: the\n");
+  fprintf(fp, "             protocol's own, or all 32 bits for a larger window)\n");
+  fprintf(fp, "  -D count   fast retransmit after count duplicate ACKs (GBN), 0 for\n");
+  fprintf(fp, "             none (default)\n");
+  fprintf(fp, "  -R 0|1     1: estimate the retransmission timeout from measured round\n");
+  fprintf(fp, "             trip times (default for SR, and with -M or -A); 0: fixed at 16\n");
+  fprintf(fp, "             (default for GBN)\n");
+  fprintf(fp, "  -C 0|1     1: congestion control, the window grows with ACKs and shrinks\n");
+  fprintf(fp, "             on loss (AIMD), up to -w; 0: the window is fixed (default)\n");
+  fprintf(fp, "  -B size    queue up to size messages while the window is full, instead\n");
+  fprintf(fp, "             of dropping them (default 0); with a fixed timeout shorter than\n");
+  fprintf(fp, "             the round trip a long backlog overloads the channel, use -R 1\n");
+  fprintf(fp, "  -K 0|1     1: selective acknowledgements, every ACK also reports the\n");
+  fprintf(fp, "             packets held by the receiver (SR); 0: one packet per ACK (default)\n");
+  fprintf(fp, "  -A count   delayed ACKs: one for every count packets received in order,\n");
+  fprintf(fp, "             or after the ACK timer at B expires (default 1); turns on -R 1\n");
+  fprintf(fp, "             unless -R 0 is given, as the delay outlasts a fixed timeout\n");
+  fprintf(fp, "  -e name    packet checksum: sum (default), inet, fletcher, adler or crc32c\n");
+  fprintf(fp, "  -M bytes   messages of this size, segmented into packets and reassembled,\n");
+  fprintf(fp, "             or min-max for sizes drawn uniformly from the range;\n");
+  fprintf(fp, "             0: one %d-byte message per packet (default)\n", PAYLOADSIZE);
+  fprintf(fp, "  -U bytes   payload bytes per packet for segmented messages, %d to %d\n",
+          SAR_HEADER + 1, PAYLOADSIZE < SAR_MAXMTU ? PAYLOADSIZE : SAR_MAXMTU);
+  fprintf(fp, "             (default %d; build with PAYLOADSIZE=n for larger packets)\n", PAYLOADSIZE);
+  fprintf(fp, "  -s seed    random number generator seed (default 9999)\n");
+  fprintf(fp, "  -g gen     random number generator: xoshiro (default), or rand to\n");
+  fprintf(fp, "             reproduce the C library rand() sequence of older versions\n");
+  fprintf(fp, "  -a 0|1     antithetic run: every random draw u is replaced by 1 - u\n");
+  fprintf(fp, "run options:\n");
+  fprintf(fp, "  -f file    run every scenario listed in file, one per line\n");
+  fprintf(fp, "  -o file    write one CSV results row per scenario to file\n");
+  fprintf(fp, "  -J file    write the results and metrics of every scenario to file as JSON\n");
+  fprintf(fp, "  -q         do not print the end-of-run report\n");
+}
@@ -0,0 +1,56 @@
+/* ******************************************************************
+   Run configuration for the emulator.
+
+   A scenario is described by the same options whether they come from
+   the command line or from a line of a scenario file, e.g.
+
+       -L lossy -n 1000 -l 0.2 -c 0.2 -d 2 -m 10
+
+   Options given on the command line are the defaults for every line of
+   the scenario file.  Lines are blank-separated; '#' starts a comment.
+**********************************************************************/
+
+#define CONFIG_LABELSIZE 64
+#define CONFIG_LINESIZE  1024
+#define CONFIG_PATHSIZE  256
+
+struct simconfig {
+  char label[CONFIG_LABELSIZE]; /* scenario name used in the results */
+  long long nsimmax;            /* number of msgs to generate, then stop */
+  float lossprob;               /* probability that a packet is dropped */
+  float corruptprob;            /* probability that one bit is packet is flipped */
+  int corruptdirection;         /* A->B A<-B or bidirectional corruption/loss */
+  float lambda;                 /* arrival rate of messages from layer 5 */
+  int trace;                    /* TRACE level for the run */
+  int windowsize;               /* sender window, 0 for the protocol's default */
+  long long seqspace;           /* sequence numbers in use, 0 for the protocol's default */
+  int dupthresh;                /* duplicate ACKs that trigger a fast retransmit, 0 for none */
+  int adaptiverto;              /* estimate the retransmission timeout from measured RTTs;
+                                   -1 for the protocol's choice, or on for segmented
+                                   messages and delayed ACKs */
+  int congestion;               /* limit the sender by a congestion window (AIMD) */
+  int backlog;                  /* messages queued while the window is full, 0 for none */
+  int sack;                     /* SR ACKs carry the receiver's cumulative point and bitmap */
+  int ackevery;                 /* in-order packets per delayed ACK, 0 or 1 for every packet */
+  int checksum;                 /* packet checksum, CKSUM_SUM etc., see checksum.h */
+  long long msgsize;            /* bytes per message, segmented (see sar.h); 0 for one msg each */
+  long long msgmax;             /* sizes uniform from msgsize up to this, or msgsize for one size */
+  int mtu;                      /* payload bytes per packet used by segmentation, 0 for PAYLOADSIZE */
+  unsigned int seed;            /* random number generator seed */
+  int rng;                      /* RNG_XOSHIRO or RNG_COMPAT, see rng.h */
+  int antithetic;               /* use 1 - u for every random draw u */
+  char tracefile[CONFIG_PATHSIZE]; /* binary trace to write, "" for none */
+  int protocol;                 /* index in protocols[], see protocol.h */
+};
+
+extern void config_defaults(struct simconfig *cfg);
+
+/* apply one scenario option; returns the number of arguments used (2),
+   0 if opt is not a scenario option, or -1 if its value is missing or bad */
+extern int config_option(struct simconfig *cfg, const char *opt, const char *arg);
+
+/* apply every option on one scenario file line; returns 1 if the line
+   described a scenario, 0 if it was blank or a comment, -1 on error */
+extern int config_parseline(struct simconfig *cfg, char *line);
+
+extern void config_usage(FILE *fp, const char *progname);
@@ -0,0 +1,56 @@
+#include <math.h>
+#include "cwnd.h"
+
+static double halve(int inflight)
+{
+  return inflight / 2.0 > CWND_MIN ? inflight / 2.0 : CWND_MIN;
+}
+
+void cwnd_init(struct cwnd *c, int limit, int enabled)
+{
+  c->enabled = enabled;
+  c->limit = limit;
+  c->cwnd = enabled ? 1.0 : limit;
+  c->ssthresh = limit;
+}
+
+int cwnd_window(const struct cwnd *c)
+{
+  return c->cwnd < c->limit ? (int)c->cwnd : c->limit;
+}
+
+void cwnd_ack(struct cwnd *c, int nacked)
+{
+  double n;
+
+  if (!c->enabled)
+    return;
+  /* one packet per packet ACKed below the threshold, then 1/cwnd */
+  if (c->cwnd < c->ssthresh) {
+    n = ceil(c->ssthresh - c->cwnd);
+    if (n > nacked)
+      n = nacked;
+    c->cwnd += n;
+    nacked -= (int)n;
+  }
+  c->cwnd += nacked / c->cwnd;
+  /* growing past the configured window would only store up a burst */
+  if (c->cwnd > c->limit)
+    c->cwnd = c->limit;
+}
+
+void cwnd_loss(struct cwnd *c, int inflight)
+{
+  if (!c->enabled)
+    return;
+  c->ssthresh = halve(inflight);
+  c->cwnd = c->ssthresh;
+}
+
+void cwnd_timeout(struct cwnd *c, int inflight)
+{
+  if (!c->enabled)
+    return;
+  c->ssthresh = halve(inflight);
+  c->cwnd = 1.0;
+}
@@ -0,0 +1,38 @@
+/* ******************************************************************
+   Congestion window, after RFC 5681.
+
+   The window starts at one packet and grows by one for every packet
+   ACKed (slow start) up to the slow start threshold, then by about one
+   per window of packets ACKed (additive increase).  A loss signalled by
+   duplicate ACKs halves it; a timeout sets the threshold to half the
+   packets in flight and restarts slow start from one packet.
+
+   The sender may have at most cwnd_window() packets outstanding, the
+   smaller of this window and the configured one, and resends no more
+   than that after a loss: the rest of its packets wait for ACKs to open
+   the window again.  When congestion control is off that is simply the
+   configured window.
+**********************************************************************/
+
+#define CWND_MIN 2.0      /* smallest threshold after a loss, in packets */
+
+struct cwnd {
+  int enabled;            /* congestion control in use */
+  int limit;              /* the configured window, in packets */
+  double cwnd;            /* congestion window, in packets */
+  double ssthresh;        /* slow start threshold, in packets */
+};
+
+extern void cwnd_init(struct cwnd *c, int limit, int enabled);
+
+/* packets the sender may have outstanding */
+extern int cwnd_window(const struct cwnd *c);
+
+/* nacked packets were newly ACKed */
+extern void cwnd_ack(struct cwnd *c, int nacked);
+
+/* duplicate ACKs signalled a loss with inflight packets outstanding */
+extern void cwnd_loss(struct cwnd *c, int inflight);
+
+/* a retransmission timeout expired with inflight packets outstanding */
+extern void cwnd_timeout(struct cwnd *c, int inflight);
@@ -36,66 +36,318 @@
    ********************************************************************* */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include "emulator.h"
-#include "gbn.h"
-
-struct event {
-  float evtime;           /* event time */
-  int evtype;             /* event type code */
-  int eventity;           /* entity where event occurs */
-  struct pkt *pktptr;     /* ptr to packet (if any) assoc w/ this event */
-  struct event *prev;
-  struct event *next;
-};
+#include "protocol.h"
+#include "evqueue.h"
+#include "evpool.h"
+#include "config.h"
+#include "rng.h"
+#include "bintrace.h"
+#include "hist.h"
+#include "checksum.h"
+#include "sar.h"
+#include "sim.h"
 
-struct event *evlist = NULL;   /* the event list */
+#ifndef EVQUEUE
+#define EVQUEUE EVQ_HEAP      /* pending-event set, see evqueue.h */
+#endif
 
 /* possible events: */
 #define  TIMER_INTERRUPT 0  
 #define  FROM_LAYER5     1
 #define  FROM_LAYER3     2
+#define  TIMER_CANCELLED 3    /* tombstone left on the list by canceltimer() */
+
+/* independent random streams, one per stochastic process, so that a
+   change in one process (e.g. how many packets a protocol sends) does not
+   shift the draws seen by the others.  The compat generator has a single
+   stream that all processes share, as rand() did. */
+#define  STREAM_ARRIVAL  0    /* message arrivals from layer 5 */
+#define  STREAM_LOSS     1    /* packet loss */
+#define  STREAM_CORRUPT  2    /* packet corruption and its kind */
+#define  STREAM_DELAY    3    /* channel delay */
+#define  STREAM_SIZE     4    /* sizes of segmented messages */
+#define  NSTREAMS        5
 
 #define  OFF             0
 #define  ON              1
 
-int TRACE = 3;
-
-/* statistics updated by GBN */
-int window_full;   /* count of the number of messages dropped due to full window */
-int total_ACKs_received;
-int packets_resent;       /* count of the number of packets resent  */
-int new_ACKs;           /* count of the number of acks correctly received */
-int packets_received;  /* count of the packets received by receiver */
-
-/* statistics updated by emulator */
-static int packets_lost;  
-static int packets_corrupt;
-static int packets_sent;
-static int packets_timeout;
-static int messages_delivered;
-
-static int nsim = 0;              /* number of messages from 5 to 4 so far */ 
-static int nsimmax = 0;           /* number of msgs to generate, then stop */
-static float time = 0.000;
-static float lossprob;            /* probability that a packet is dropped  */
-static float corruptprob;   /* probability that one bit is packet is flipped */
-static int corruptdirection; /* A->B A<-B or bidirectional corruption/loss */
-static float lambda;        /* arrival rate of messages from layer 5 */   
-static int   ntolayer3;           /* number sent into layer 3 */
-static int   nlost;               /* number lost in media */
-static int ncorrupt;              /* number corrupted by media*/
+/* table of running timers, indexed by the low bits of a timerhandle; the
+   high bits hold the slot's generation so stale handles are recognised */
+struct timerslot {
+  struct event *ev;       /* pending TIMER_INTERRUPT event, NULL if free */
+  unsigned int gen;       /* bumped every time the slot is released */
+  int tag;                /* tag given to settimer() */
+  int nextfree;           /* next free slot, -1 ends the list */
+};
+
+/* times at which the messages of one direction were accepted by the
+   sending entity and are not yet delivered, oldest first, in a ring
+   that doubles when full */
+struct msgfifo {
+  double *t;
+  long long head, count, cap;
+};
+
+#define LATENCYUNIT 0.001     /* resolution of the latency histogram */
+
+/* A sender whose timeout is shorter than the round trip resends packets
+   that are still on their way, which lengthens the queue on the channel
+   and so the round trip.  With a backlog (-B) or segmented messages
+   (-M) to keep its window full the queue then grows without end, and so
+   would the run.  Such a run is stopped once one direction of the
+   channel holds OVERLOAD packets for each packet of the window (taken
+   as at least 64).  Without them the window empties between messages,
+   the queue drains and the run ends by itself, so it is never stopped. */
+#define OVERLOAD 64
+
+#define TIMERSLOTBITS 32
+#define LEGACYTAG (-1)        /* tag of timers started by starttimer() */
+
+/* header of a sim_alloc() block, aligned for any data that follows it */
+union simblock {
+  union simblock *next;
+  max_align_t align;
+};
+
+struct sim {
+  struct simconfig cfg;         /* parameters of the run */
+  const struct protocol *proto; /* protocols[cfg.protocol] */
+  struct simstats stats;
+  struct simrng rng[NSTREAMS];
+  double time;
+
+  struct evqueue evlist;        /* the event list */
+  struct evpool evpool;         /* storage for the events on evlist */
+  long long mallocs;            /* heap allocations growing the timer table and the
+                                   latency rings; see allocations() for the rest */
+  long long warmup_mallocs;     /* allocations() when half the messages were sent */
+
+  struct timerslot *timers;
+  int ntimerslots;
+  int freetimer;
+  timerhandle legacytimer[2];   /* starttimer()'s timer for A and B */
+  int firedtag;
+
+  /* latest arrival time scheduled on the channel towards A and towards B */
+  double lastarrival[2];
+
+  /* packets on the channel towards A and towards B, and the most it may
+     hold before the run is stopped as overloaded */
+  long long inflight[2];
+  long long maxinflight;
+
+  void *protostate[2];          /* see sim_state() */
+  union simblock *blocks;       /* see sim_alloc(), newest first */
+
+  /* metrics: end-to-end latency, from the message entering layer 4 at
+     one side to its delivery to layer 5 at the other, and the time the
+     channel towards A and towards B carried at least one packet */
+  struct msgfifo accepted[2];
+  struct hist latency;
+  double busy[2];
+
+  struct sar sar;               /* segmentation of messages of cfg.msgsize bytes and up */
+
+  /* binary trace, NULL if none.  A record whose flags depend on what the
+     protocol does after it was made is held back in btpending, with the
+     counters it is judged by, until the next record or the end of the
+     event; btpending.type is 0 when nothing is held. */
+  struct bintrace *bt;
+  struct btrecord btpending;
+  long long btresent, btfull;
+};
+
+/* the simulation being run by this thread */
+static _Thread_local struct sim *sim;
+
+int sim_trace(void)
+{
+  return sim->cfg.trace;
+}
+
+int sim_window(int dflt)
+{
+  return sim->cfg.windowsize > 0 ? sim->cfg.windowsize : dflt;
+}
+
+long long sim_seqspace(long long dflt)
+{
+  return sim->cfg.seqspace > 0 ? sim->cfg.seqspace : dflt;
+}
+
+int sim_dupthresh(void)
+{
+  return sim->cfg.dupthresh;
+}
+
+int sim_adaptiverto(int dflt)
+{
+  if (sim->cfg.adaptiverto < 0)
+    sim->cfg.adaptiverto = dflt;
+  return sim->cfg.adaptiverto;
+}
+
+int sim_congestion(void)
+{
+  return sim->cfg.congestion;
+}
+
+int sim_backlog(void)
+{
+  return sim->cfg.backlog;
+}
+
+int sim_sack(void)
+{
+  return sim->cfg.sack;
+}
+
+int sim_checksum(void)
+{
+  return sim->cfg.checksum;
+}
+
+int sim_ackevery(void)
+{
+  return sim->cfg.ackevery > 1 ? sim->cfg.ackevery : 1;
+}
+
+double sim_time(void)
+{
+  return sim->time;
+}
+
+struct simstats *sim_stats(void)
+{
+  return &sim->stats;
+}
+
+void *sim_state(int AorB, size_t size)
+{
+  if (sim->protostate[AorB] == NULL) {
+    sim->protostate[AorB] = calloc(1, size);
+    if (sim->protostate[AorB] == NULL) {
+      printf("memory allocation for protocol state failed.");
+      exit(EXIT_FAILURE);
+    }
+  }
+  return sim->protostate[AorB];
+}
+
+void *sim_alloc(size_t size)
+{
+  union simblock *b = calloc(1, sizeof(union simblock) + size);
+
+  if (b == NULL) {
+    printf("memory allocation for protocol state failed.");
+    exit(EXIT_FAILURE);
+  }
+  b->next = sim->blocks;
+  sim->blocks = b;
+  return b + 1;
+}
+
+/********************** METRICS *****************************************/
+
+static void fifo_push(struct msgfifo *f, double t)
+{
+  double *nt;
+  long long i;
+
+  if (f->count == f->cap) {
+    nt = malloc((f->cap > 0 ? 2 * f->cap : 16) * sizeof(double));
+    sim->mallocs++;
+    if (nt == NULL) {
+      printf("memory allocation for message times failed.");
+      exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < f->count; i++)
+      nt[i] = f->t[(f->head + i) % f->cap];
+    free(f->t);
+    f->t = nt;
+    f->head = 0;
+    f->cap = f->cap > 0 ? 2 * f->cap : 16;
+  }
+  f->t[(f->head + f->count) % f->cap] = t;
+  f->count++;
+}
+
+/* heap allocations the engine has made while running: event slabs, event
+   queue growth, timer table and latency ring growth */
+static long long allocations(const struct sim *s)
+{
+  return s->evpool.mallocs + s->evlist.mallocs + s->mallocs;
+}
+
+/* oldest time in the ring, or -1 if it is empty */
+static double fifo_pop(struct msgfifo *f)
+{
+  double t;
+
+  if (f->count == 0)
+    return -1.0;
+  t = f->t[f->head];
+  f->head = (f->head + 1) % f->cap;
+  f->count--;
+  return t;
+}
+
+/********************** BINARY TRACE ************************************/
+
+/* write the held-back record, flagged by what the protocol has counted
+   since: a resend right after a send, a full window after a message */
+static void btcommit(void)
+{
+  struct btrecord *r = &sim->btpending;
+
+  if (r->type == 0)
+    return;
+  if (r->type == BT_SEND && sim->stats.packets_resent > sim->btresent)
+    r->flags |= BTF_RETRANSMIT;
+  if (r->type == BT_MESSAGE && sim->stats.window_full + sim->stats.sar_dropped > sim->btfull)
+    r->flags |= BTF_REFUSED;
+  bt_write(sim->bt, r);
+  r->type = 0;
+}
+
+/* add a record to the binary trace; p may be NULL */
+static void btrecord(int type, int AorB, long long id, const struct pkt *p, int seq, int flags)
+{
+  struct btrecord r;
+
+  btcommit();
+  r.time = sim->time;
+  r.pktid = id;
+  r.seq = p != NULL ? p->seqnum : seq;
+  r.ack = p != NULL ? p->acknum : 0;
+  r.type = type;
+  r.entity = AorB;
+  r.flags = flags;
+  r.reserved = 0;
+  if (type == BT_SEND || type == BT_MESSAGE) {
+    sim->btpending = r;
+    sim->btresent = sim->stats.packets_resent;
+    sim->btfull = sim->stats.window_full + sim->stats.sar_dropped;
+  }
+  else
+    bt_write(sim->bt, &r);
+}
 
 /****************************************************************************/
 /* jimsrand(): return a double in range [0,1].  The routine below is used to */
-/* isolate all random number generation in one location.  We assume that the*/
-/* system-supplied rand() function return an int in therange [0,mmm]        */
+/* isolate all random number generation in one location.  The uniforms come */
+/* from one of the simulation's own streams, a batch at a time (rng.h).    */
 /****************************************************************************/
-double jimsrand(void) 
+double jimsrand(int stream) 
 {
-  double mmm = RAND_MAX;     /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
   double x;                   
-  x = rand()/mmm;            /* x should be uniform in [0,1] */
-  if (TRACE > 3)
+  if (sim->cfg.rng == RNG_COMPAT)
+    stream = 0;
+  x = rng_uniform(&sim->rng[stream]);   /* x should be uniform in [0,1] */
+  if (TRACING(4))
     printf("RANDOM NUMBER GENERAION CALLED: %f\n", x);
   return(x);
 }  
@@ -106,39 +358,11 @@ double jimsrand(void)
 
 void insertevent(struct event *p)
 {
-  struct event *q,*qold;
-
-  if (TRACE>2) {
-    printf("            INSERTEVENT: time is %f\n",time);
+  if (TRACING(3)) {
+    printf("            INSERTEVENT: time is %f\n",sim->time);
     printf("            INSERTEVENT: future time will be %f\n",p->evtime); 
   }
-  q = evlist;     /* q points to front of list in which p struct inserted */
-  if (q==NULL) {   /* list is empty */
-    evlist=p;
-    p->next=NULL;
-    p->prev=NULL;
-  }
-  else {
-    for (qold = q; q !=NULL && p->evtime > q->evtime; q=q->next)
-      qold=q; 
-    if (q==NULL) {   /* end of list */
-      qold->next = p;
-      p->prev = qold;
-      p->next = NULL;
-    }
-    else if (q==evlist) { /* front of list */
-      p->next=evlist;
-      p->prev=NULL;
-      p->next->prev=p;
-      evlist = p;
-    }
-    else {     /* middle of list */
-      p->next=q;
-      p->prev=q->prev;
-      q->prev->next=p;
-      q->prev=p;
-    }
-  }
+  evq_insert(&sim->evlist, p);
 }
 
 void generate_next_arrival(void)
@@ -146,61 +370,62 @@ void generate_next_arrival(void)
   double x;
   struct event *evptr;
 
-  if (TRACE>2)
+  if (TRACING(3))
     printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
  
-  x = lambda*jimsrand()*2;  /* x is uniform on [0,2*lambda] */
+  x = sim->cfg.lambda*jimsrand(STREAM_ARRIVAL)*2;  /* x is uniform on [0,2*lambda] */
   /* having mean of lambda        */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  evptr->evtime =  time + x;
+  evptr = evpool_get(&sim->evpool);
+  evptr->evtime =  sim->time + x;
   evptr->evtype =  FROM_LAYER5;
-  if (BIDIRECTIONAL && (jimsrand()>0.5) )
+  if (BIDIRECTIONAL && (jimsrand(STREAM_ARRIVAL)>0.5) )
     evptr->eventity = B;
   else
     evptr->eventity = A;
   insertevent(evptr);
 } 
 
+static void printevent(struct event *q, void *arg)
+{
+  printf("Event time: %f, type: %d entity: %d\n",q->evtime,q->evtype,q->eventity);
+}
+
 void printevlist(void)
 {
-  struct event *q;
-  printf("--------------\nEvent List Follows:\n");
-  for(q = evlist; q!=NULL; q=q->next) {
-    printf("Event time: %f, type: %d entity: %d\n",q->evtime,q->evtype,q->eventity);
-  }
+  printf("--------------\nEvent List Follows (%s, unordered):\n", evq_name(sim->evlist.kind));
+  evq_foreach(&sim->evlist, printevent, NULL);
   printf("--------------\n");
 }
 
-void init(void)                         /* initialize the simulator */
+/********************** SIMULATION CONTEXT ******************************/
+
+/* create a simulation, ready to run, with its own copy of cfg */
+struct sim *sim_create(const struct simconfig *cfg)
 {
+  struct sim *s, *prev = sim;
   float sum, avg;
   int i;
 
-  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
-  printf("Enter the number of messages to simulate: ");
-  scanf("%d",&nsimmax);
-  printf("Enter  packet loss probability [enter 0.0 for no loss]:");
-  scanf("%f",&lossprob);
-  printf("Enter packet corruption probability [0.0 for no corruption]:");
-  scanf("%f",&corruptprob);
-  if (lossprob != 0.0 || corruptprob != 0.0) {
-    printf("If you want loss or corruption to only occur in one direction, choose the direction: 0 A->B, 1 A<-B, 2 A<->B (both directions) :");
-    scanf("%d",&corruptdirection);
+  s = calloc(1, sizeof(struct sim));
+  if (s == NULL) {
+    printf("memory allocation for simulation failed.");
+    exit(EXIT_FAILURE);
   }
-  printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
-  scanf("%f",&lambda);
-  printf("Enter TRACE:");
-  scanf("%d",&TRACE);
-
+  s->cfg = *cfg;
+  /* a fixed timeout is too short for a window of back-to-back segments,
+     or for an ACK held back at B on top of the round trip */
+  if (s->cfg.adaptiverto < 0 && (cfg->msgsize > 0 || cfg->ackevery > 1))
+    s->cfg.adaptiverto = 1;
+  s->proto = protocols[cfg->protocol];
+  sim = s;
 
-  srand(9999);              /* init random number generator */
+  for (i=0; i<NSTREAMS; i++) {   /* init random number generator */
+    rng_seed(&s->rng[i], cfg->rng, cfg->seed, i);
+    s->rng[i].antithetic = cfg->antithetic;
+  }
   sum = 0.0;                /* test random number generator for students */
   for (i=0; i<1000; i++)
-    sum+=jimsrand();    /* jimsrand() should be uniform in [0,1] */
+    sum+=jimsrand(STREAM_ARRIVAL);    /* jimsrand() should be uniform in [0,1] */
   avg = sum/1000.0;
   if (avg < 0.25 || avg > 0.75) {
     printf("It is likely that random number generation on your machine\n" ); 
@@ -209,55 +434,183 @@ void init(void)                         /* initialize the simulator */
     exit(EXIT_FAILURE);
   }
 
-  /* initialise statistics */
-  window_full = 0;
-  total_ACKs_received = 0;
-  packets_resent = 0;
-  new_ACKs = 0;
-  packets_received = 0;
-  packets_lost = 0;  
-  packets_corrupt = 0;
-  packets_sent = 0;
-  packets_timeout = 0;
-  messages_delivered = 0;
-
-  ntolayer3 = 0;
-  nlost = 0;
-  ncorrupt = 0;
-
-  time=0.0;                    /* initialize time to 0.0 */
+  s->time=0.0;                 /* initialize time to 0.0 */
+  evq_init(&s->evlist, EVQUEUE);
+  evpool_init(&s->evpool);
+  s->warmup_mallocs = -1;
+  s->freetimer = -1;
+  s->legacytimer[A] = NOTIMER;
+  s->legacytimer[B] = NOTIMER;
+  hist_init(&s->latency, LATENCYUNIT);
+  sar_init(&s->sar, cfg->msgmax, cfg->mtu > 0 ? cfg->mtu : PAYLOADSIZE);
+  if (cfg->backlog > 0 || cfg->msgsize > 0)
+    s->maxinflight = OVERLOAD * (cfg->windowsize > 64 ? (long long)cfg->windowsize : 64LL);
+  else
+    s->maxinflight = LLONG_MAX;
   generate_next_arrival();     /* initialize event list */
+
+  if (cfg->tracefile[0] != '\0') {
+    s->bt = bt_open(cfg->tracefile);
+    if (s->bt == NULL) {
+      printf("unable to create binary trace %s.\n", cfg->tracefile);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  sim = prev;
+  return s;
+}
+
+void sim_destroy(struct sim *s)
+{
+  union simblock *b;
+
+  if (s->bt != NULL)
+    bt_close(s->bt);
+  evq_free(&s->evlist);
+  evpool_free(&s->evpool);
+  free(s->timers);
+  free(s->protostate[A]);
+  free(s->protostate[B]);
+  while (s->blocks != NULL) {
+    b = s->blocks;
+    s->blocks = b->next;
+    free(b);
+  }
+  free(s->accepted[A].t);
+  free(s->accepted[B].t);
+  hist_free(&s->latency);
+  sar_free(&s->sar);
+  free(s);
+}
+
+const struct simstats *sim_getstats(const struct sim *s)
+{
+  return &s->stats;
+}
+
+double sim_endtime(const struct sim *s)
+{
+  return s->time;
+}
+
+long long sim_events(const struct sim *s)
+{
+  return s->evpool.gets;
+}
+
+void sim_call(struct sim *s, void (*fn)(void *), void *arg)
+{
+  struct sim *prev = sim;
+
+  sim = s;
+  fn(arg);
+  sim = prev;
 }
 
 /********************** Student-callable ROUTINES ***********************/
 
+static struct timerslot *timerlookup(timerhandle h)
+{
+  int slot;
+
+  if (h < 0)
+    return NULL;
+  slot = (int)(h & ((1LL << TIMERSLOTBITS) - 1));
+  if (slot >= sim->ntimerslots || sim->timers[slot].ev == NULL ||
+      sim->timers[slot].gen != (unsigned int)(h >> TIMERSLOTBITS))
+    return NULL;
+  return &sim->timers[slot];
+}
+
+static void timerrelease(int slot)
+{
+  sim->timers[slot].ev = NULL;
+  sim->timers[slot].gen++;
+  sim->timers[slot].nextfree = sim->freetimer;
+  sim->freetimer = slot;
+}
+
+static timerhandle newtimer(int AorB, double increment, int tag)
+{
+  struct timerslot *t;
+  struct event *evptr;
+  int slot, i;
+
+  if (sim->freetimer < 0) {
+    i = sim->ntimerslots;
+    sim->ntimerslots = sim->ntimerslots ? 2 * sim->ntimerslots : 16;
+    sim->timers = realloc(sim->timers, sim->ntimerslots * sizeof(struct timerslot));
+    sim->mallocs++;
+    if (sim->timers == NULL) {
+      printf("memory allocation for timer failed.");
+      exit(EXIT_FAILURE);
+    }
+    for (; i < sim->ntimerslots; i++) {
+      sim->timers[i].ev = NULL;
+      sim->timers[i].gen = 0;
+      sim->timers[i].nextfree = sim->freetimer;
+      sim->freetimer = i;
+    }
+  }
+  slot = sim->freetimer;
+  t = &sim->timers[slot];
+  sim->freetimer = t->nextfree;
+
+  /* create future event for when timer goes off */
+  evptr = evpool_get(&sim->evpool);
+  evptr->evtime =  sim->time + increment;
+  evptr->evtype =  TIMER_INTERRUPT;
+  evptr->eventity = AorB;
+  evptr->evtimer = slot;
+  t->ev = evptr;
+  t->tag = tag;
+  insertevent(evptr);
+
+  return ((timerhandle)t->gen << TIMERSLOTBITS) | slot;
+}
+
+timerhandle settimer(int AorB, double increment, int tag)
+{
+  if (TRACING(2))
+    printf("          SET TIMER: starting timer %d at %f\n",tag,sim->time);
+  return newtimer(AorB, increment, tag);
+}
+
+/* the event is left on the list as a tombstone and skipped when it
+   comes up, so cancelling never has to search or reorder the list */
+int canceltimer(timerhandle h)
+{
+  struct timerslot *t = timerlookup(h);
+
+  if (TRACING(2))
+    printf("          CANCEL TIMER: cancelling timer at %f\n",sim->time);
+  if (t == NULL)
+    return 0;
+  t->ev->evtype = TIMER_CANCELLED;
+  timerrelease(t->ev->evtimer);
+  return 1;
+}
+
+int firedtimer(void)
+{
+  return sim->firedtag;
+}
+
 /* called by students routine to cancel a previously-started timer */
 void stoptimer(int AorB)
 /* A or B is trying to stop timer */
 {
-  struct event *q;
-
-  if (TRACE>1)
-    printf("          STOP TIMER: stopping timer at %f\n",time);
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q=evlist; q!=NULL ; q = q->next) 
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) { 
-      /* remove this event */
-      if (q->next==NULL && q->prev==NULL)
-        evlist=NULL;         /* remove first and only event on list */
-      else if (q->next==NULL) /* end of list - there is one in front */
-        q->prev->next = NULL;
-      else if (q==evlist) { /* front of list - there must be event after */
-        q->next->prev=NULL;
-        evlist = q->next;
-      }
-      else {     /* middle of list */
-        q->next->prev = q->prev;
-        q->prev->next =  q->next;
-      }
-      free(q);
-      return;
-    }
+  struct timerslot *t = timerlookup(sim->legacytimer[AorB]);
+
+  if (TRACING(2))
+    printf("          STOP TIMER: stopping timer at %f\n",sim->time);
+  if (t != NULL) {
+    t->ev->evtype = TIMER_CANCELLED;
+    timerrelease(t->ev->evtimer);
+    sim->legacytimer[AorB] = NOTIMER;
+    return;
+  }
   printf("Warning: unable to cancel your timer. It wasn't running.\n");
 }
 
@@ -265,32 +618,14 @@ void stoptimer(int AorB)
 void starttimer(int AorB, double increment)
 /* A or B is trying to start timer */
 {
-
-  struct event *q;
-  struct event *evptr;
-
-  if (TRACE>1)
-    printf("          START TIMER: starting timer at %f\n",time);
+  if (TRACING(2))
+    printf("          START TIMER: starting timer at %f\n",sim->time);
   /* be nice: check to see if timer is already started, if so, then  warn */
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q=evlist; q!=NULL ; q = q->next)  
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) { 
-      printf("Warning: attempt to start a timer that is already started\n");
-      return;
-    }
- 
-  /* create future event for when timer goes off */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
+  if (timerlookup(sim->legacytimer[AorB]) != NULL) {
+    printf("Warning: attempt to start a timer that is already started\n");
+    return;
   }
-  evptr->evtime =  time + increment;
-  evptr->evtype =  TIMER_INTERRUPT;
-   
- 
-  evptr->eventity = AorB;
-  insertevent(evptr);
+  sim->legacytimer[AorB] = newtimer(AorB, increment, LEGACYTAG);
 } 
 
 
@@ -299,116 +634,167 @@ void tolayer3(int AorB, struct pkt packet)
 /* A or B is sending to network  */
 {
   struct pkt *mypktptr;
-  struct event *evptr,*q;
-  float lastime, x;
+  struct event *evptr;
+  double lastime, x;
   int i;
+  int corruptdirection = sim->cfg.corruptdirection;
+  long long ncorrupt = sim->stats.ncorrupt;
 
-  ntolayer3++;
+  sim->stats.ntolayer3++;
 
   /* simulate losses: */
-  if (jimsrand() < lossprob && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
-    nlost++;
-    if (TRACE>0)    
+  if (jimsrand(STREAM_LOSS) < sim->cfg.lossprob && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
+    sim->stats.nlost++;
+    if (sim->bt != NULL)
+      btrecord(BT_SEND, AorB, sim->stats.ntolayer3, &packet, 0, BTF_LOST);
+    if (TRACING(1))    
       printf("          TOLAYER3: packet being lost\n");
     return;
   }  
 
+  /* create future event for arrival of packet at the other side */
+  evptr = evpool_get(&sim->evpool);
+  evptr->evtype =  FROM_LAYER3;   /* packet will pop out from layer3 */
+  evptr->eventity = (AorB+1) % 2; /* event occurs at other entity */
+
   /* make a copy of the packet student just gave me since he/she may decide */
   /* to do something with the packet after we return back to him/her */ 
-  mypktptr = malloc(sizeof(struct pkt));
-  if (mypktptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  mypktptr->seqnum = packet.seqnum;
-  mypktptr->acknum = packet.acknum;
-  mypktptr->checksum = packet.checksum;
-  for (i=0; i<20; i++)
-    mypktptr->payload[i] = packet.payload[i];
-  if (TRACE>2)  {
+  mypktptr = &evptr->pkt;
+  *mypktptr = packet;
+  if (TRACING(3))  {
     printf("          TOLAYER3: seq: %d, ack %d, check: %d ", mypktptr->seqnum,
            mypktptr->acknum,  mypktptr->checksum);
-    for (i=0; i<20; i++)
+    for (i=0; i<PAYLOADSIZE; i++)
       printf("%c",mypktptr->payload[i]);
     printf("\n");
   }
 
-  /* create future event for arrival of packet at the other side */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  evptr->evtype =  FROM_LAYER3;   /* packet will pop out from layer3 */
-  evptr->eventity = (AorB+1) % 2; /* event occurs at other entity */
-  evptr->pktptr = mypktptr;       /* save ptr to my copy of packet */
   /* finally, compute the arrival time of packet at the other end.
      medium can not reorder, so make sure packet arrives between 1 and 10
      time units after the latest arrival time of packets
-     currently in the medium on their way to the destination */
-  lastime = time;
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next) */
-  for (q=evlist; q!=NULL ; q = q->next) 
-    if ( (q->evtype==FROM_LAYER3  && q->eventity==evptr->eventity) ) 
-      lastime = q->evtime;
-  evptr->evtime =  lastime + 1 + 9*jimsrand();
+     currently in the medium on their way to the destination.
+     Arrivals on one direction are scheduled in increasing time order, so
+     the latest one still in the medium is lastarrival[] if that lies in
+     the future; if it has already been delivered the medium is empty. */
+  lastime = sim->time;
+  if (sim->lastarrival[evptr->eventity] > lastime)
+    lastime = sim->lastarrival[evptr->eventity];
+  evptr->evtime =  lastime + 1 + 9*jimsrand(STREAM_DELAY);
+  sim->lastarrival[evptr->eventity] = evptr->evtime;
+  sim->busy[evptr->eventity] += evptr->evtime - lastime;
  
 
 
   /* simulate corruption: */
-  if ((jimsrand() < corruptprob)  && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
-    ncorrupt++;
-    if ( (x = jimsrand()) < .75)
+  if ((jimsrand(STREAM_CORRUPT) < sim->cfg.corruptprob)  && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
+    sim->stats.ncorrupt++;
+    if ( (x = jimsrand(STREAM_CORRUPT)) < .75)
       mypktptr->payload[0]='Z';   /* corrupt payload */
     else if (x < .875)
       mypktptr->seqnum = 999999;
     else
       mypktptr->acknum = 999999;
-    if (TRACE>0)    
+    if (TRACING(1))    
       printf("          TOLAYER3: packet being corrupted\n");
   }  
 
-  if (TRACE>2)  
+  if (sim->bt != NULL) {
+    evptr->evpktid = sim->stats.ntolayer3;
+    evptr->evbtflags = sim->stats.ncorrupt > ncorrupt ? BTF_CORRUPT : 0;
+    btrecord(BT_SEND, AorB, evptr->evpktid, &packet, 0, evptr->evbtflags);
+  }
+
+  if (++sim->inflight[evptr->eventity] > sim->maxinflight)
+    sim->stats.overloaded = 1;
+
+  if (TRACING(3))  
     printf("          TOLAYER3: scheduling arrival on other side\n");
   insertevent(evptr);
 } 
 
-void tolayer5(int AorB, char datasent[20])
+void tolayer5(int AorB, char datasent[PAYLOADSIZE])
 {
   int i;  
-  if (TRACE>2) {
+  double t;
+  long long bytes = PAYLOADSIZE;
+  if (TRACING(3)) {
     printf("          TOLAYER5: data received by application at ");
     if (AorB == A) 
       printf("A: ");
     else
       printf("B: ");
-    for (i=0; i<20; i++)  
+    for (i=0; i<PAYLOADSIZE; i++)  
       printf("%c",datasent[i]);
     printf("\n");
   }
-  messages_delivered++;
+  /* a segment reaches the application only as the last of its message */
+  if (sim->sar.maxsize > 0 && (bytes = sar_receive(&sim->sar, datasent)) == 0)
+    return;
+  sim->stats.messages_delivered++;
+  sim->stats.bytes_delivered += bytes;
+  t = fifo_pop(&sim->accepted[(AorB+1) % 2]);
+  if (t >= 0.0)
+    hist_add(&sim->latency, sim->time - t);
+  if (sim->bt != NULL)
+    btrecord(BT_DELIVER, AorB, 0, NULL, 0, 0);
 }
 
-int main(void)
+/* a size for the next segmented message */
+static long long nextsize(struct sim *s)
 {
+  long long range = s->cfg.msgmax - s->cfg.msgsize;
+  long long size;
+
+  if (range == 0)
+    return s->cfg.msgsize;
+  size = s->cfg.msgsize + (long long)((range + 1) * jimsrand(STREAM_SIZE));
+  return size < s->cfg.msgmax ? size : s->cfg.msgmax;
+}
+
+/* pass the segments of the queued messages to the protocol while it can
+   take them; the rest wait until ACKs make room */
+static void sendsegments(struct sim *s)
+{
+  const struct sarmsg *q;
+  struct msg m;
+  int entity;
+
+  while ((q = sar_head(&s->sar)) != NULL) {
+    entity = q->entity;
+    if (!(entity == A ? s->proto->A_ready() : s->proto->B_ready()))
+      break;
+    sar_next(&s->sar, &m);
+    if (entity == A)
+      s->proto->A_output(m);
+    else
+      s->proto->B_output(m);
+  }
+}
+
+void sim_run(struct sim *s)
+{
+  struct sim *prev = sim;
   struct event *eventptr;
   struct msg  msg2give;
   struct pkt  pkt2give;
+  long long full;
+  int accepted;
    
   int i,j;
   
-  init();
-  A_init();
-  B_init();
+  sim = s;
+  s->proto->A_init();
+  s->proto->B_init();
    
   while (1) {
-    eventptr = evlist;            /* get next event to simulate */
+    eventptr = evq_popmin(&s->evlist); /* get next event to simulate */
     if (eventptr==NULL)
-      goto terminate;
-    evlist = evlist->next;        /* remove this event from event list */
-    if (evlist!=NULL)
-      evlist->prev=NULL;
-    if (TRACE>=2) {
+      break;
+    if (eventptr->evtype == TIMER_CANCELLED) {
+      evpool_put(&s->evpool, eventptr);
+      continue;
+    }
+    if (TRACING(2)) {
       printf("\nEVENT time: %f,",eventptr->evtime);
       printf("  type: %d",eventptr->evtype);
       if (eventptr->evtype==0)
@@ -419,60 +805,228 @@ int main(void)
         printf(", fromlayer3 ");
       printf(" entity: %d\n",eventptr->eventity);
     }
-    time = eventptr->evtime;        /* update time to next event time */
+    s->time = eventptr->evtime;        /* update time to next event time */
     if (eventptr->evtype == FROM_LAYER5 ) {
-      if (nsim < nsimmax) {
+      if (s->stats.nsim < s->cfg.nsimmax) {
         generate_next_arrival();   /* set up future arrival */
         /* fill in msg to give with string of same letter */    
-        j = nsim % 26; 
-        for (i=0; i<20; i++)  
+        j = s->stats.nsim % 26; 
+        for (i=0; i<PAYLOADSIZE; i++)  
           msg2give.data[i] = 97 + j;
-        if (TRACE>2) {
+        if (TRACING(3)) {
           printf("          MAINLOOP: data given to student: ");
-          for (i=0; i<20; i++) 
+          for (i=0; i<PAYLOADSIZE; i++) 
             printf("%c", msg2give.data[i]);
           printf("\n");
         }
-        nsim++;
-        if (eventptr->eventity == A) 
-          A_output(msg2give);  
-        else
-          B_output(msg2give);  
+        s->stats.nsim++;
+        if (s->stats.nsim == s->cfg.nsimmax / 2)
+          s->warmup_mallocs = allocations(s);
+        if (s->bt != NULL)
+          btrecord(BT_MESSAGE, eventptr->eventity, s->stats.nsim, NULL, 0, 0);
+        full = s->stats.window_full;
+        if (s->sar.maxsize > 0) {
+          accepted = sar_put(&s->sar, (unsigned int)s->stats.nsim, eventptr->eventity, nextsize(s), 97 + j);
+          if (!accepted)
+            s->stats.sar_dropped++;
+        }
+        else {
+          if (eventptr->eventity == A) 
+            s->proto->A_output(msg2give);  
+          else
+            s->proto->B_output(msg2give);  
+          accepted = s->stats.window_full == full;
+        }
+        /* a message the protocol did not count as refused is in its care */
+        if (accepted)
+          fifo_push(&s->accepted[eventptr->eventity], s->time);
       }
-      else if (TRACE > 2)
+      else if (TRACING(3))
           printf("          FROM_LAYER5: no more messages to send: \n");
     }
     else if (eventptr->evtype ==  FROM_LAYER3) {
-      pkt2give.seqnum = eventptr->pktptr->seqnum;
-      pkt2give.acknum = eventptr->pktptr->acknum;
-      pkt2give.checksum = eventptr->pktptr->checksum;
-      for (i=0; i<20; i++)  
-        pkt2give.payload[i] = eventptr->pktptr->payload[i];
+      s->inflight[eventptr->eventity]--;
+      pkt2give = eventptr->pkt;
+      if (s->bt != NULL)
+        btrecord(BT_ARRIVE, eventptr->eventity, eventptr->evpktid, &pkt2give, 0,
+                 eventptr->evbtflags);
 	    if (eventptr->eventity ==A)      /* deliver packet by calling */
-        A_input(pkt2give);            /* appropriate entity */
+        s->proto->A_input(pkt2give);  /* appropriate entity */
       else
-        B_input(pkt2give);
-	    free(eventptr->pktptr);          /* free the memory for packet */
+        s->proto->B_input(pkt2give);
     }
     else if (eventptr->evtype ==  TIMER_INTERRUPT) {
+      s->firedtag = s->timers[eventptr->evtimer].tag;
+      timerrelease(eventptr->evtimer);
+      if (s->bt != NULL)
+        btrecord(BT_TIMEOUT, eventptr->eventity, 0, NULL, s->firedtag, 0);
       if (eventptr->eventity == A) 
-        A_timerinterrupt();
+        s->proto->A_timerinterrupt();
       else
-        B_timerinterrupt();
+        s->proto->B_timerinterrupt();
     }
     else  {
       printf("INTERNAL PANIC: unknown event type \n");
     }
-    free(eventptr);
+    if (s->sar.maxsize > 0)
+      sendsegments(s);
+    if (s->bt != NULL)
+      btcommit();
+    evpool_put(&s->evpool, eventptr);
+    if (s->stats.overloaded)
+      break;
   }
+  if (s->bt != NULL)
+    bt_flush(s->bt);
+
+  sim = prev;
+}
+
+/* time the channel towards A or B carried a packet up to the end of the
+   run.  busy[] runs up to the last arrival scheduled, which a run stopped
+   as overloaded leaves in the future; the channel is busy throughout
+   that stretch, as every packet sent so far is queued on it. */
+static double busytime(const struct sim *s, int AorB)
+{
+  double ahead = s->lastarrival[AorB] - s->time;
 
- terminate:
-  printf(" Simulator terminated at time %f\n after attempting to send %d msgs from layer5\n",time,nsim);
-  printf("number of messages dropped due to full window:  %d \n", window_full);
-  printf("number of valid (not corrupt or duplicate) acknowledgements received at A:  %d \n", new_ACKs);
-  printf("(note: a single acknowledgement may have acknowledged more than one packet - if cumulative acknowledgements are used)\n");
-  printf("number of packet resends by A:  %d \n", packets_resent);
-  printf("number of correct packets received at B:  %d \n", packets_received);
-  printf("number of messages delivered to application:  %d \n", messages_delivered);
-  return EXIT_SUCCESS;
-}
\ No newline at end of file
+  return ahead > 0.0 ? s->busy[AorB] - ahead : s->busy[AorB];
+}
+
+void sim_getmetrics(const struct sim *s, struct simmetrics *m)
+{
+  const struct simstats *st = &s->stats;
+  long long accepted = st->nsim - (s->sar.maxsize > 0 ? st->sar_dropped : st->window_full);
+
+  m->latency_count = s->latency.n;
+  m->latency_mean = hist_mean(&s->latency);
+  m->latency_p50 = hist_quantile(&s->latency, 0.5);
+  m->latency_p99 = hist_quantile(&s->latency, 0.99);
+  m->latency_p999 = hist_quantile(&s->latency, 0.999);
+  m->latency_max = s->latency.max;
+  m->goodput = s->time > 0.0 ? st->messages_delivered / s->time : 0.0;
+  m->goodput_bytes = s->time > 0.0 ? st->bytes_delivered / s->time : 0.0;
+  m->utilization[A] = s->time > 0.0 ? busytime(s, A) / s->time : 0.0;
+  m->utilization[B] = s->time > 0.0 ? busytime(s, B) / s->time : 0.0;
+  m->resend_overhead = accepted > 0 ? (double)st->packets_resent / accepted : 0.0;
+  /* Little's law: the mean depth is the total waiting time over the run */
+  m->backlog_depth = s->time > 0.0 ? st->backlog_wait / s->time : 0.0;
+  m->backlog_wait = st->backlog_queued > 0 ? st->backlog_wait / st->backlog_queued : 0.0;
+}
+
+void sim_report(const struct sim *s, FILE *fp)
+{
+  const struct simstats *st = &s->stats;
+  struct simmetrics m;
+
+  fprintf(fp, "protocol: %s\n", s->proto->name);
+  if (st->overloaded)
+    fprintf(fp, "run stopped: over %lld packets queued on the channel, which could no longer drain\n"
+            "(the retransmission timeout is shorter than the round trip; try -R 1)\n", s->maxinflight);
+  fprintf(fp, " Simulator terminated at time %f\n after attempting to send %lld msgs from layer5\n",s->time,st->nsim);
+  fprintf(fp, "number of messages dropped due to full window:  %lld \n", st->window_full);
+  fprintf(fp, "number of valid (not corrupt or duplicate) acknowledgements received at A:  %lld \n", st->new_ACKs);
+  fprintf(fp, "(note: a single acknowledgement may have acknowledged more than one packet - if cumulative acknowledgements are used)\n");
+  fprintf(fp, "number of packet resends by A:  %lld \n", st->packets_resent);
+  fprintf(fp, "number of correct packets received at B:  %lld \n", st->packets_received);
+  fprintf(fp, "number of messages delivered to application:  %lld \n", st->messages_delivered);
+  fprintf(fp, "number of retransmission timeouts at A:  %lld \n", st->timeouts);
+  fprintf(fp, "number of fast retransmits by A:  %lld \n", st->fast_retransmits);
+  fprintf(fp, "number of ACKs saved by delaying them at B:  %lld \n", st->acks_saved);
+  fprintf(fp, "retransmission timeout at A:  %f (smoothed RTT %f)\n", st->rto, st->srtt);
+  fprintf(fp, "congestion window at A:  %f \n", st->cwnd);
+  fprintf(fp, "event pool: %lld events from %lld heap allocations (peak %lld pending); "
+          "%lld allocations in the engine after warm-up\n",
+          s->evpool.gets, s->evpool.mallocs, s->evpool.peak,
+          s->warmup_mallocs < 0 ? allocations(s) : allocations(s) - s->warmup_mallocs);
+  sim_getmetrics(s, &m);
+  fprintf(fp, "end-to-end latency of %lld messages: mean %f, p50 %f, p99 %f, p99.9 %f, max %f\n",
+          m.latency_count, m.latency_mean, m.latency_p50, m.latency_p99, m.latency_p999, m.latency_max);
+  fprintf(fp, "goodput: %f messages per time unit, %f bytes\n", m.goodput, m.goodput_bytes);
+  if (s->sar.maxsize > 0 && s->cfg.msgmax > s->cfg.msgsize)
+    fprintf(fp, "segmentation: messages of %lld to %lld bytes in packets of %d payload bytes; "
+            "%lld messages lost to a full queue\n", s->cfg.msgsize, s->cfg.msgmax, s->sar.mtu, st->sar_dropped);
+  else if (s->sar.maxsize > 0)
+    fprintf(fp, "segmentation: %lld-byte messages in packets of %d payload bytes; %lld messages lost to a full queue\n",
+            s->sar.maxsize, s->sar.mtu, st->sar_dropped);
+  fprintf(fp, "channel utilization: A->B %f, B->A %f\n", m.utilization[B], m.utilization[A]);
+  fprintf(fp, "resend overhead: %f packets resent per message accepted\n", m.resend_overhead);
+  fprintf(fp, "sender backlog: %lld messages sent from it, depth mean %f, peak %lld; wait mean %f, max %f\n",
+          st->backlog_queued, m.backlog_depth, st->backlog_peak, m.backlog_wait, st->backlog_maxwait);
+}
+
+void sim_writeresultsheader(FILE *fp)
+{
+  fprintf(fp, "label,protocol,messages,loss,corrupt,direction,lambda,window,seqspace,dupthresh,"
+          "adaptive_rto,congestion,backlog,sack,ack_every,checksum,msg_size,msg_max,mtu,seed,rng,antithetic,"
+          "end_time,overloaded,msgs_sent,window_full,sar_dropped,total_acks,new_acks,packets_resent,timeouts,"
+          "fast_retransmits,acks_saved,rto,srtt,cwnd,packets_received,messages_delivered,"
+          "bytes_delivered,packets_lost,packets_corrupted,latency_mean,latency_p50,"
+          "latency_p99,latency_p999,latency_max,goodput,goodput_bytes,utilization_ab,utilization_ba,"
+          "resend_overhead,backlog_queued,backlog_depth,backlog_peak,backlog_wait,backlog_maxwait\n");
+}
+
+void sim_writeresults(const struct sim *s, FILE *fp)
+{
+  const struct simconfig *cfg = &s->cfg;
+  const struct simstats *st = &s->stats;
+  struct simmetrics m;
+
+  sim_getmetrics(s, &m);
+  fprintf(fp, "%s,%s,%lld,%g,%g,%d,%g,%d,%lld,%d,%d,%d,%d,%d,%d,%s,%lld,%lld,%d,%u,%s,%d,"
+          "%f,%d,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%f,%f,%f,%lld,%lld,%lld,%lld,%lld,"
+          "%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%lld,%f,%lld,%f,%f\n",
+          cfg->label, s->proto->name, cfg->nsimmax, cfg->lossprob, cfg->corruptprob,
+          cfg->corruptdirection, cfg->lambda, cfg->windowsize, cfg->seqspace, cfg->dupthresh,
+          cfg->adaptiverto, cfg->congestion, cfg->backlog, cfg->sack, cfg->ackevery,
+          checksum_name(cfg->checksum), cfg->msgsize, cfg->msgmax, s->sar.mtu, cfg->seed,
+          rng_name(cfg->rng), cfg->antithetic, s->time, st->overloaded, st->nsim, st->window_full, st->sar_dropped,
+          st->total_ACKs_received, st->new_ACKs, st->packets_resent, st->timeouts,
+          st->fast_retransmits, st->acks_saved, st->rto, st->srtt, st->cwnd, st->packets_received,
+          st->messages_delivered, st->bytes_delivered, st->nlost, st->ncorrupt,
+          m.latency_mean, m.latency_p50, m.latency_p99, m.latency_p999, m.latency_max,
+          m.goodput, m.goodput_bytes, m.utilization[B], m.utilization[A], m.resend_overhead,
+          st->backlog_queued, m.backlog_depth, st->backlog_peak, m.backlog_wait, st->backlog_maxwait);
+}
+
+void sim_writejson(const struct sim *s, FILE *fp)
+{
+  const struct simconfig *cfg = &s->cfg;
+  const struct simstats *st = &s->stats;
+  struct simmetrics m;
+  const char *c;
+
+  sim_getmetrics(s, &m);
+  fprintf(fp, "{\"label\": \"");
+  for (c = cfg->label; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\')
+      fputc('\\', fp);
+    fputc(*c, fp);
+  }
+  fprintf(fp, "\", \"protocol\": \"%s\", \"messages\": %lld, \"loss\": %g, \"corrupt\": %g, \"direction\": %d, "
+          "\"lambda\": %g, \"window\": %d, \"seqspace\": %lld, \"dupthresh\": %d, \"adaptive_rto\": %d, "
+          "\"congestion\": %d, \"backlog\": %d, \"sack\": %d, \"ack_every\": %d, \"checksum\": \"%s\", "
+          "\"msg_size\": %lld, \"msg_max\": %lld, \"mtu\": %d, \"seed\": %u, \"rng\": \"%s\", \"antithetic\": %d,\n",
+          s->proto->name, cfg->nsimmax, cfg->lossprob, cfg->corruptprob, cfg->corruptdirection, cfg->lambda,
+          cfg->windowsize, cfg->seqspace, cfg->dupthresh, cfg->adaptiverto, cfg->congestion, cfg->backlog,
+          cfg->sack, cfg->ackevery, checksum_name(cfg->checksum), cfg->msgsize, cfg->msgmax, s->sar.mtu,
+          cfg->seed, rng_name(cfg->rng), cfg->antithetic);
+  fprintf(fp, " \"end_time\": %f, \"overloaded\": %d, \"msgs_sent\": %lld, \"window_full\": %lld, "
+          "\"sar_dropped\": %lld, \"total_acks\": %lld, \"new_acks\": %lld, \"packets_resent\": %lld, "
+          "\"timeouts\": %lld, \"fast_retransmits\": %lld, \"acks_saved\": %lld, \"rto\": %f, "
+          "\"srtt\": %f, \"cwnd\": %f, \"packets_received\": %lld, \"messages_delivered\": %lld, \"bytes_delivered\": %lld, "
+          "\"packets_lost\": %lld, \"packets_corrupted\": %lld,\n",
+          s->time, st->overloaded, st->nsim, st->window_full, st->sar_dropped,
+          st->total_ACKs_received, st->new_ACKs, st->packets_resent, st->timeouts,
+          st->fast_retransmits, st->acks_saved, st->rto, st->srtt, st->cwnd, st->packets_received,
+          st->messages_delivered, st->bytes_delivered, st->nlost, st->ncorrupt);
+  fprintf(fp, " \"latency\": {\"count\": %lld, \"mean\": %f, \"p50\": %f, \"p99\": %f, "
+          "\"p999\": %f, \"max\": %f},\n",
+          m.latency_count, m.latency_mean, m.latency_p50, m.latency_p99, m.latency_p999,
+          m.latency_max);
+  fprintf(fp, " \"goodput\": %f, \"goodput_bytes\": %f, \"utilization_ab\": %f, \"utilization_ba\": %f, "
+          "\"resend_overhead\": %f,\n \"sender_backlog\": {\"queued\": %lld, \"depth\": %f, \"peak\": %lld, "
+          "\"wait\": %f, \"maxwait\": %f}}",
+          m.goodput, m.goodput_bytes, m.utilization[B], m.utilization[A], m.resend_overhead,
+          st->backlog_queued, m.backlog_depth, st->backlog_peak, m.backlog_wait, st->backlog_maxwait);
+}
@@ -1,20 +1,120 @@
-extern int TRACE;
+#include <stddef.h>
 
-/* statistics updated by GBN */
-extern int total_ACKs_received;
-extern int packets_resent;       /* count of the number of packets resent  */
-extern int new_ACKs;      /* count of the number of acks correctly received */
-extern int packets_received;  /* count of the packets received by receiver */
-extern int window_full; /* count of the number of messages dropped due to full window */
+/* Every routine below acts on the simulation currently being run by the
+   calling thread, so several simulations may run side by side. */
+
+/* TRACE level of the current simulation */
+extern int sim_trace(void);
+#define TRACE (sim_trace())
+
+/* highest TRACE level compiled in.  Tracing at a higher level is dead
+   code the compiler removes, so a build with -DTRACE_MAX=0 carries no
+   trace checks at all; the runtime level can only lower the output. */
+#ifndef TRACE_MAX
+#define TRACE_MAX 4
+#endif
+
+/* true if trace output of level n (1 = protocol events .. 4 = every
+   random draw) is wanted; test with if (TRACING(n)) */
+#define TRACING(n) ((n) <= TRACE_MAX && TRACE >= (n))
+
+/* sender window size configured for the current simulation, or the
+   given default if the configuration leaves it to the protocol */
+extern int sim_window(int);
+
+/* sequence space configured for the current simulation, or the given
+   default if the configuration leaves it to the protocol */
+extern long long sim_seqspace(long long);
+
+/* duplicate ACKs after which the sender retransmits without waiting for
+   its timer, or 0 if the current simulation does not fast retransmit */
+extern int sim_dupthresh(void);
+
+/* true if the sender should estimate its retransmission timeout from
+   measured round trip times rather than use a fixed one.  If the
+   configuration leaves it to the protocol the first call settles it, for
+   the whole simulation, as the given default. */
+extern int sim_adaptiverto(int);
+
+/* true if the sender should run congestion control (AIMD) */
+extern int sim_congestion(void);
+
+/* messages the sender may queue while its window is full, 0 for none */
+extern int sim_backlog(void);
+
+/* true if the receiver should report every packet it holds in each
+   ACK, and the sender take them all as ACKed (SR) */
+extern int sim_sack(void);
+
+/* packets the receiver should receive in order for each ACK it sends,
+   1 for an ACK for every packet */
+extern int sim_ackevery(void);
+
+/* checksum the protocols should put on their packets, see checksum.h */
+extern int sim_checksum(void);
+
+/* simulated time now in the current simulation */
+extern double sim_time(void);
+
+/* statistics of the current simulation */
+struct simstats {
+  /* updated by GBN */
+  long long total_ACKs_received;
+  long long packets_resent;       /* count of the number of packets resent  */
+  long long new_ACKs;      /* count of the number of acks correctly received */
+  long long packets_received;  /* count of the packets received by receiver */
+  long long window_full; /* count of the number of messages dropped due to full window */
+  long long fast_retransmits; /* count of retransmissions triggered by duplicate ACKs */
+  long long timeouts;      /* count of the retransmission timeouts at the sender */
+  double rto;              /* the sender's retransmission timeout, latest value */
+  double srtt;             /* the sender's smoothed round trip time, 0 if not estimated */
+  double cwnd;             /* the sender's congestion window, latest value */
+  long long backlog_queued; /* messages sent after waiting in the sender's backlog */
+  long long backlog_peak;  /* most messages in the backlog at once */
+  double backlog_wait;     /* total time the messages sent from the backlog waited */
+  double backlog_maxwait;  /* longest time one of them waited */
+  long long acks_saved;    /* ACKs the receiver held back and never sent */
+
+  /* updated by the emulator */
+  long long nsim;           /* number of messages from 5 to 4 so far */
+  long long messages_delivered; /* number of messages passed up to layer 5 */
+  long long bytes_delivered; /* bytes of the messages passed up to layer 5 */
+  long long sar_dropped;    /* segmented messages lost to a full queue */
+  long long ntolayer3;      /* number sent into layer 3 */
+  long long nlost;          /* number lost in media */
+  long long ncorrupt;       /* number corrupted by media */
+  int overloaded;           /* the run was stopped as the channel could not drain */
+};
+
+extern struct simstats *sim_stats(void);
+
+/* protocol state of A or B (int) in the current simulation: a zero-filled
+   block of the given size, allocated on first use and freed with the
+   simulation */
+extern void *sim_state(int, size_t);
+
+/* a zero-filled block of the given size for the protocol's use, such as
+   buffers sized at run time; freed with the current simulation */
+extern void *sim_alloc(size_t);
 
 #define   A    0
 #define   B    1
 
+/* bytes of data in a msg and in the payload of a pkt: 20 in the original
+   assignment, and by default; build with -DPAYLOADSIZE=n for larger
+   packets, carrying messages segmented by the emulator (see sar.h) */
+#ifndef PAYLOADSIZE
+#define PAYLOADSIZE 20
+#endif
+#if PAYLOADSIZE < 20
+#error "PAYLOADSIZE must be at least the original 20 bytes"
+#endif
+
 /* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
 /* 4 (students' code).  It contains the data (characters) to be delivered */
 /* to layer 5 via the students transport level protocol entities.         */
 struct msg {
-  char data[20];
+  char data[PAYLOADSIZE];
 };
 
 /* a packet is the data unit passed from layer 4 (students code) to layer */
@@ -24,17 +124,35 @@ struct pkt {
   int seqnum;
   int acknum;
   int checksum;
-  char payload[20];
+  char payload[PAYLOADSIZE];
 };
 
 /* send to A or B (int), packet to send */
 extern void tolayer3(int, struct pkt);  
 
 /* deliver to A or B (int), data to deliver */
-extern void tolayer5(int, char[20]); 
+extern void tolayer5(int, char[PAYLOADSIZE]); 
 
 /* start timer at A or B (int), increment */
 extern void starttimer(int, double);       
 
 /* stop timer at A or B (int) */
 extern void stoptimer(int);               
+
+/* starttimer()/stoptimer() allow one timer per entity.  The calls below
+   let A or B run any number of timers at once; each is identified by the
+   handle settimer() returns and can be cancelled in constant time.  When
+   one goes off the entity's timer interrupt routine is called as usual
+   and firedtimer() tells it which tag the expiring timer was given. */
+typedef long long timerhandle;
+#define NOTIMER (-1LL)          /* never returned by settimer() */
+
+/* start timer at A or B (int), increment, tag; returns its handle */
+extern timerhandle settimer(int, double, int);
+
+/* cancel a timer by handle; returns 1 if it was still pending, else 0 */
+extern int canceltimer(timerhandle);
+
+/* tag of the timer that caused the current timer interrupt */
+extern int firedtimer(void);
+
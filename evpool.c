@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "emulator.h"
+#include "evqueue.h"
+#include "evpool.h"
+
+struct evslab {
+  struct evslab *next;
+  struct event ev[EVPOOL_SLAB];
+};
+
+void evpool_init(struct evpool *pool)
+{
+  pool->freelist = NULL;
+  pool->slabs = NULL;
+  pool->mallocs = 0;
+  pool->gets = 0;
+  pool->live = 0;
+  pool->peak = 0;
+}
+
+/* bulk teardown: releases every slab, including events still handed out */
+void evpool_free(struct evpool *pool)
+{
+  struct evslab *s, *snext;
+
+  for (s = pool->slabs; s != NULL; s = snext) {
+    snext = s->next;
+    free(s);
+  }
+  pool->slabs = NULL;
+  pool->freelist = NULL;
+  pool->live = 0;
+}
+
+struct event *evpool_get(struct evpool *pool)
+{
+  struct evslab *s;
+  struct event *p;
+  int i;
+
+  if (pool->freelist == NULL) {
+    s = malloc(sizeof(struct evslab));
+    if (s == 0) {
+      printf("memory allocation for event failed.");
+      exit(EXIT_FAILURE);
+    }
+    pool->mallocs++;
+    s->next = pool->slabs;
+    pool->slabs = s;
+    for (i = EVPOOL_SLAB - 1; i >= 0; i--) {
+      s->ev[i].next = pool->freelist;
+      pool->freelist = &s->ev[i];
+    }
+  }
+  p = pool->freelist;
+  pool->freelist = p->next;
+  pool->gets++;
+  pool->live++;
+  if (pool->live > pool->peak)
+    pool->peak = pool->live;
+  return p;
+}
+
+void evpool_put(struct evpool *pool, struct event *p)
+{
+  p->next = pool->freelist;
+  pool->freelist = p;
+  pool->live--;
+}
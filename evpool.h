@@ -0,0 +1,26 @@
+/* ******************************************************************
+   Free-list allocator for emulator events.
+
+   Events are carved out of slabs of EVPOOL_SLAB entries and recycled
+   through a free list, so once the pool has grown to the peak number of
+   pending events the simulation makes no further heap calls.  All slabs
+   are released together by evpool_free().
+**********************************************************************/
+
+#define EVPOOL_SLAB 256   /* events per slab */
+
+struct evslab;
+
+struct evpool {
+  struct event *freelist; /* recycled events, linked through next */
+  struct evslab *slabs;   /* every slab allocated so far */
+  long long mallocs;      /* number of heap allocations made by the pool */
+  long long gets;         /* number of events handed out */
+  long long live;         /* events currently handed out */
+  long long peak;         /* largest value live has reached */
+};
+
+extern void evpool_init(struct evpool *pool);
+extern void evpool_free(struct evpool *pool);
+extern struct event *evpool_get(struct evpool *pool);
+extern void evpool_put(struct evpool *pool, struct event *p);
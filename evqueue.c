@@ -0,0 +1,373 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "emulator.h"
+#include "evqueue.h"
+
+/* ******************************************************************
+   Pending-event set for the emulator.  See evqueue.h for the ordering
+   rules; every implementation below must agree with evbefore().
+**********************************************************************/
+
+#define CAL_MINBUCKETS 16
+
+static void *evq_alloc(size_t size)
+{
+  void *p = malloc(size);
+  if (p == 0) {
+    printf("memory allocation for event queue failed.");
+    exit(EXIT_FAILURE);
+  }
+  return p;
+}
+
+/* true if event a must be handled before event b */
+static int evbefore(const struct event *a, const struct event *b)
+{
+  if (a->evtime != b->evtime)
+    return a->evtime < b->evtime;
+  return a->evseq > b->evseq;   /* equal times: newest first */
+}
+
+/********************* SORTED LIST *******************/
+
+static void list_insert(struct evqueue *q, struct event *p)
+{
+  struct event *e, *eold;
+
+  e = q->head;
+  if (e == NULL) {     /* list is empty */
+    q->head = p;
+    p->next = NULL;
+    p->prev = NULL;
+    return;
+  }
+  for (eold = e; e != NULL && evbefore(e, p); e = e->next)
+    eold = e;
+  if (e == NULL) {     /* end of list */
+    eold->next = p;
+    p->prev = eold;
+    p->next = NULL;
+  }
+  else if (e == q->head) { /* front of list */
+    p->next = q->head;
+    p->prev = NULL;
+    p->next->prev = p;
+    q->head = p;
+  }
+  else {               /* middle of list */
+    p->next = e;
+    p->prev = e->prev;
+    e->prev->next = p;
+    e->prev = p;
+  }
+}
+
+static void list_unlink(struct event **head, struct event *p)
+{
+  if (p->prev != NULL)
+    p->prev->next = p->next;
+  else
+    *head = p->next;
+  if (p->next != NULL)
+    p->next->prev = p->prev;
+  p->next = NULL;
+  p->prev = NULL;
+}
+
+/********************* BINARY HEAP *******************/
+
+static void heap_place(struct evqueue *q, struct event *p, int i)
+{
+  q->heap[i] = p;
+  p->heapidx = i;
+}
+
+static void heap_siftup(struct evqueue *q, int i)
+{
+  struct event *p = q->heap[i];
+  int parent;
+
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (!evbefore(p, q->heap[parent]))
+      break;
+    heap_place(q, q->heap[parent], i);
+    i = parent;
+  }
+  heap_place(q, p, i);
+}
+
+static void heap_siftdown(struct evqueue *q, int i)
+{
+  struct event *p = q->heap[i];
+  int child;
+
+  for (;;) {
+    child = 2 * i + 1;
+    if (child >= q->count)
+      break;
+    if (child + 1 < q->count && evbefore(q->heap[child + 1], q->heap[child]))
+      child++;
+    if (!evbefore(q->heap[child], p))
+      break;
+    heap_place(q, q->heap[child], i);
+    i = child;
+  }
+  heap_place(q, p, i);
+}
+
+static void heap_insert(struct evqueue *q, struct event *p)
+{
+  if (q->count == q->heapcap) {
+    q->heapcap = q->heapcap ? 2 * q->heapcap : 64;
+    q->heap = realloc(q->heap, q->heapcap * sizeof(struct event *));
+    q->mallocs++;
+    if (q->heap == NULL) {
+      printf("memory allocation for event queue failed.");
+      exit(EXIT_FAILURE);
+    }
+  }
+  heap_place(q, p, q->count);
+  q->count++;
+  heap_siftup(q, q->count - 1);
+}
+
+static void heap_remove(struct evqueue *q, struct event *p)
+{
+  int i = p->heapidx;
+
+  q->count--;
+  if (i == q->count)
+    return;
+  heap_place(q, q->heap[q->count], i);
+  if (i > 0 && evbefore(q->heap[i], q->heap[(i - 1) / 2]))
+    heap_siftup(q, i);
+  else
+    heap_siftdown(q, i);
+}
+
+/********************* CALENDAR QUEUE ****************/
+
+static long long cal_vbucket(const struct evqueue *q, double t)
+{
+  return (long long)(t / q->width);
+}
+
+static struct event **cal_bucket(const struct evqueue *q, double t)
+{
+  return &q->buckets[cal_vbucket(q, t) & (q->nbuckets - 1)];
+}
+
+static void cal_link(struct evqueue *q, struct event *p)
+{
+  struct event **head = cal_bucket(q, p->evtime);
+  struct event *e, *eold = NULL;
+
+  for (e = *head; e != NULL && evbefore(e, p); e = e->next)
+    eold = e;
+  p->prev = eold;
+  p->next = e;
+  if (e != NULL)
+    e->prev = p;
+  if (eold != NULL)
+    eold->next = p;
+  else
+    *head = p;
+}
+
+/* rebuild the calendar with nbuckets days, estimating a new day width
+   from the spread of the events currently queued */
+static void cal_resize(struct evqueue *q, int nbuckets)
+{
+  struct event *all = NULL, *e, *enext;
+  double tmin = 0, tmax = 0;
+  int i, n = 0;
+
+  for (i = 0; i < q->nbuckets; i++)
+    for (e = q->buckets[i]; e != NULL; e = enext) {
+      enext = e->next;
+      if (n == 0 || e->evtime < tmin)
+        tmin = e->evtime;
+      if (n == 0 || e->evtime > tmax)
+        tmax = e->evtime;
+      e->next = all;
+      all = e;
+      n++;
+    }
+  free(q->buckets);
+
+  q->nbuckets = nbuckets;
+  q->buckets = evq_alloc(nbuckets * sizeof(struct event *));
+  q->mallocs++;
+  for (i = 0; i < nbuckets; i++)
+    q->buckets[i] = NULL;
+  /* about three events per occupied day works well in practice */
+  if (n > 1 && tmax > tmin)
+    q->width = 3.0 * (tmax - tmin) / n;
+  q->curbucket = cal_vbucket(q, q->lastprio);
+
+  for (e = all; e != NULL; e = enext) {
+    enext = e->next;
+    cal_link(q, e);
+  }
+}
+
+static void cal_insert(struct evqueue *q, struct event *p)
+{
+  cal_link(q, p);
+  q->count++;
+  if (q->count > 2 * q->nbuckets)
+    cal_resize(q, 2 * q->nbuckets);
+}
+
+static void cal_remove(struct evqueue *q, struct event *p)
+{
+  list_unlink(cal_bucket(q, p->evtime), p);
+  q->count--;
+  if (q->nbuckets > CAL_MINBUCKETS && q->count < q->nbuckets / 2)
+    cal_resize(q, q->nbuckets / 2);
+}
+
+static struct event *cal_popmin(struct evqueue *q)
+{
+  struct event *e, *best;
+  int i;
+
+  if (q->count == 0)
+    return NULL;
+
+  /* scan forward one "year" from the current day */
+  for (i = 0; i < q->nbuckets; i++, q->curbucket++) {
+    e = q->buckets[q->curbucket & (q->nbuckets - 1)];
+    if (e != NULL && cal_vbucket(q, e->evtime) <= q->curbucket)
+      goto found;
+  }
+
+  /* nothing due this year: jump straight to the earliest event */
+  best = NULL;
+  for (i = 0; i < q->nbuckets; i++) {
+    e = q->buckets[i];
+    if (e != NULL && (best == NULL || evbefore(e, best)))
+      best = e;
+  }
+  e = best;
+  q->curbucket = cal_vbucket(q, e->evtime);
+
+ found:
+  q->lastprio = e->evtime;
+  cal_remove(q, e);
+  return e;
+}
+
+/********************* INTERFACE *********************/
+
+void evq_init(struct evqueue *q, int kind)
+{
+  int i;
+
+  q->kind = kind;
+  q->count = 0;
+  q->nextseq = 0;
+  q->mallocs = 0;
+  q->head = NULL;
+  q->heap = NULL;
+  q->heapcap = 0;
+  q->buckets = NULL;
+  q->nbuckets = 0;
+  q->width = 1.0;
+  q->curbucket = 0;
+  q->lastprio = 0.0;
+  if (kind == EVQ_CALENDAR) {
+    q->nbuckets = CAL_MINBUCKETS;
+    q->buckets = evq_alloc(q->nbuckets * sizeof(struct event *));
+    for (i = 0; i < q->nbuckets; i++)
+      q->buckets[i] = NULL;
+  }
+}
+
+/* releases the queue's own storage; events still queued are not freed */
+void evq_free(struct evqueue *q)
+{
+  free(q->heap);
+  free(q->buckets);
+  q->heap = NULL;
+  q->buckets = NULL;
+  q->head = NULL;
+  q->count = 0;
+}
+
+void evq_insert(struct evqueue *q, struct event *p)
+{
+  p->evseq = q->nextseq++;
+  switch (q->kind) {
+  case EVQ_HEAP:
+    heap_insert(q, p);
+    break;
+  case EVQ_CALENDAR:
+    cal_insert(q, p);
+    break;
+  default:
+    list_insert(q, p);
+    q->count++;
+    break;
+  }
+}
+
+struct event *evq_popmin(struct evqueue *q)
+{
+  struct event *p;
+
+  if (q->count == 0)
+    return NULL;
+  switch (q->kind) {
+  case EVQ_HEAP:
+    p = q->heap[0];
+    heap_remove(q, p);
+    return p;
+  case EVQ_CALENDAR:
+    return cal_popmin(q);
+  default:
+    p = q->head;
+    list_unlink(&q->head, p);
+    q->count--;
+    return p;
+  }
+}
+
+void evq_foreach(struct evqueue *q, void (*fn)(struct event *, void *), void *arg)
+{
+  struct event *e, *enext;
+  int i;
+
+  switch (q->kind) {
+  case EVQ_HEAP:
+    for (i = 0; i < q->count; i++)
+      fn(q->heap[i], arg);
+    break;
+  case EVQ_CALENDAR:
+    for (i = 0; i < q->nbuckets; i++)
+      for (e = q->buckets[i]; e != NULL; e = enext) {
+        enext = e->next;
+        fn(e, arg);
+      }
+    break;
+  default:
+    for (e = q->head; e != NULL; e = enext) {
+      enext = e->next;
+      fn(e, arg);
+    }
+    break;
+  }
+}
+
+const char *evq_name(int kind)
+{
+  switch (kind) {
+  case EVQ_HEAP:
+    return "heap";
+  case EVQ_CALENDAR:
+    return "calendar";
+  default:
+    return "list";
+  }
+}
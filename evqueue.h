@@ -0,0 +1,62 @@
+/* ******************************************************************
+   Pending-event set used by the emulator.
+
+   Events are kept ordered by evtime.  Events with equal evtime come out
+   newest first, which is the order the original sorted-list insertevent()
+   produced, so a run gives the same results whichever queue is selected.
+
+   Three implementations sit behind the same insert/pop-min calls:
+   - EVQ_LIST:     the original sorted doubly linked list, O(n) insert
+   - EVQ_HEAP:     binary heap, O(log n) insert and pop-min
+   - EVQ_CALENDAR: calendar queue (R. Brown, CACM 1988), O(1) expected
+                   insert and pop-min
+**********************************************************************/
+
+struct event {
+  double evtime;          /* event time */
+  int evtype;             /* event type code */
+  int eventity;           /* entity where event occurs */
+  struct pkt pkt;         /* copy of the packet (FROM_LAYER3 events only) */
+  int evtimer;            /* timer table slot (TIMER_INTERRUPT events only) */
+  long long evpktid;      /* packet number in the binary trace (FROM_LAYER3 only) */
+  int evbtflags;          /* BTF_ flags of its arrival record (FROM_LAYER3 only) */
+  unsigned long evseq;    /* insertion order, used to break ties on evtime */
+  int heapidx;            /* position in the heap array (EVQ_HEAP only) */
+  struct event *prev;
+  struct event *next;
+};
+
+#define  EVQ_LIST        0
+#define  EVQ_HEAP        1
+#define  EVQ_CALENDAR    2
+
+struct evqueue {
+  int kind;               /* one of the EVQ_ constants above */
+  int count;              /* number of events currently queued */
+  unsigned long nextseq;  /* evseq given to the next inserted event */
+  long long mallocs;      /* heap allocations made to grow or resize the queue */
+
+  /* EVQ_LIST */
+  struct event *head;
+
+  /* EVQ_HEAP */
+  struct event **heap;
+  int heapcap;
+
+  /* EVQ_CALENDAR */
+  struct event **buckets; /* each bucket is a sorted doubly linked list */
+  int nbuckets;           /* always a power of two */
+  double width;           /* time span covered by one bucket */
+  long long curbucket;    /* "virtual" bucket of the last event popped */
+  double lastprio;        /* evtime of the last event popped */
+};
+
+extern void evq_init(struct evqueue *q, int kind);
+extern void evq_free(struct evqueue *q);
+extern void evq_insert(struct evqueue *q, struct event *p);
+extern struct event *evq_popmin(struct evqueue *q);
+
+/* call fn on every queued event, in no particular order */
+extern void evq_foreach(struct evqueue *q, void (*fn)(struct event *, void *), void *arg);
+
+extern const char *evq_name(int kind);
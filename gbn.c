@@ -2,7 +2,14 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include "emulator.h"
+#include "protocol.h"
 #include "gbn.h"
+#include "window.h"
+#include "rto.h"
+#include "cwnd.h"
+#include "backlog.h"
+#include "ackdelay.h"
+#include "checksum.h"
 
 /* ******************************************************************
    Go Back N protocol.  Adapted from J.F.Kurose
@@ -20,243 +27,403 @@
    - removed bidirectional GBN code and other code not used by prac. 
    - fixed C style to adhere to current programming style
    - added GBN implementation
+   - window size and sequence space set at run time (-w, -S), with
+   32-bit serial number arithmetic for windows of any size
+   - optional fast retransmit of the window after a number of duplicate
+   ACKs (-D), instead of waiting for the timer
+   - optional retransmission timeout estimated from measured round trip
+   times (-R), see rto.h
+   - optional congestion window limiting the packets in flight (-C),
+   see cwnd.h
+   - optional backlog of messages waiting for room in the window (-B),
+   see backlog.h
+   - optional delayed ACKs, one for every few packets received in order
+   (-A), see ackdelay.h
 **********************************************************************/
 
-#define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment */
-#define WINDOWSIZE 6    /* the maximum number of buffered unacked packet */
+#define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment;
+                           the initial timeout, and the only one unless it is adaptive */
+#define WINDOWSIZE 6    /* the default maximum number of buffered unacked packet */
 #define SEQSPACE 7      /* the min sequence space for GBN must be at least windowsize + 1 */
 #define NOTINUSE (-1)   /* used to fill header fields that are not being used */
 
 /* generic procedure to compute the checksum of a packet.  Used by both sender and receiver  
    the simulator will overwrite part of your packet with 'z's.  It will not overwrite your 
    original checksum.  This procedure must generate a different checksum to the original if
-   the packet is corrupted.
+   the packet is corrupted.  The algorithm is chosen at run time (-e), see checksum.h.
 */
-int ComputeChecksum(struct pkt packet)
+static int ComputeChecksum(const struct pkt *packet)
 {
-  int checksum = 0;
-  int i;
-
-  checksum = packet.seqnum;
-  checksum += packet.acknum;
-  for ( i=0; i<20; i++ ) 
-    checksum += (int)(packet.payload[i]);
-
-  return checksum;
+  return checksum_pkt(sim_checksum(), packet);
 }
 
-bool IsCorrupted(struct pkt packet)
+static bool IsCorrupted(const struct pkt *packet)
 {
-  if (packet.checksum == ComputeChecksum(packet))
+  if (packet->checksum == ComputeChecksum(packet))
     return (false);
   else
     return (true);
 }
 
+/* window size and sequence space of the current simulation.  By default
+   a window larger than WINDOWSIZE gets the full 32-bit sequence space. */
+static void GetWindow(int *windowsize, long long *seqspace)
+{
+  *windowsize = sim_window(WINDOWSIZE);
+  *seqspace = sim_seqspace(*windowsize <= WINDOWSIZE ? SEQSPACE : SEQSPACE32);
+  if (*seqspace < *windowsize + 1LL) {
+    printf("GBN: a window of %d packets needs a sequence space of at least %d.\n",
+           *windowsize, *windowsize + 1);
+    exit(EXIT_FAILURE);
+  }
+}
+
 
 /********* Sender (A) variables and functions ************/
 
-static struct pkt buffer[WINDOWSIZE];  /* array for storing packets waiting for ACK */
-static int windowfirst, windowlast;    /* array indexes of the first/last packet awaiting ACK */
-static int windowcount;                /* the number of packets currently awaiting an ACK */
-static int A_nextseqnum;               /* the next sequence number to be used by the sender */
+struct sender {
+  struct pkt *buffer;             /* ring of windowsize packets waiting for ACK */
+  double *senttime;               /* when each packet in the ring was first sent */
+  double *lastsent;               /* when each packet in the ring was last resent */
+  int windowfirst;                /* ring index of the oldest packet awaiting ACK */
+  int windowcount;                /* the number of packets currently awaiting an ACK */
+  int windowsent;                 /* of those, the oldest ones sent since the last go-back */
+  unsigned int A_base;            /* sequence number of the oldest packet awaiting ACK */
+  unsigned int A_nextseqnum;      /* the next sequence number to be used by the sender */
+  int windowsize;                 /* send window in use */
+  long long seqspace;             /* sequence numbers in use */
+  int dupacks;                    /* duplicate ACKs of the packet before A_base received */
+  int dupthresh;                  /* dupacks that trigger a fast retransmit, 0 for none */
+  long long recover;              /* packets to be ACKed before the next fast retransmit */
+  struct rto rto;                 /* retransmission timeout */
+  struct cwnd cwnd;               /* congestion window */
+  struct backlog backlog;         /* messages waiting for room in the window */
+};
+
+/* make the current timeout and congestion window part of the run's statistics */
+static void NoteEstimates(struct sender *s)
+{
+  sim_stats()->rto = s->rto.rto;
+  sim_stats()->srtt = s->rto.srtt;
+  sim_stats()->cwnd = s->cwnd.cwnd;
+}
 
-/* called from layer 5 (application layer), passed the message to be sent to other side */
-void A_output(struct msg message)
+/* resend the packets awaiting ACK that have not been resent since the
+   last go-back, as far as the congestion window allows */
+static void ResendPending(struct sender *s)
+{
+  int slot;
+
+  while (s->windowsent < s->windowcount && s->windowsent < cwnd_window(&s->cwnd)) {
+    slot = (s->windowfirst + s->windowsent) % s->windowsize;
+    s->lastsent[slot] = sim_time();
+    /* count the copy, for the receiver to echo (see rto.h) */
+    if (s->rto.adaptive) {
+      s->buffer[slot].acknum++;
+      s->buffer[slot].checksum = ComputeChecksum(&s->buffer[slot]);
+    }
+
+    if (TRACING(1))
+      printf ("---A: resending packet %u\n",
+              (unsigned int)s->buffer[slot].seqnum);
+
+    tolayer3(A,s->buffer[slot]);
+    sim_stats()->packets_resent++;
+    s->windowsent++;
+  }
+}
+
+/* go back: resend the packets awaiting ACK and restart the timer.  Only
+   as many go at once as the congestion window allows, the rest as ACKs
+   open it again.  The resent packets the receiver already has draw
+   duplicate ACKs of their own, so as in NewReno (RFC 6582) there is no
+   fast retransmit until an ACK covers a packet sent after them. */
+static void ResendWindow(struct sender *s)
+{
+  s->recover = s->windowcount + 1;
+  s->windowsent = 0;
+  ResendPending(s);
+  if (s->windowcount > 0)
+    starttimer(A,s->rto.rto);
+}
+
+/* put message in a packet, keep it in the window buffer and send it */
+static void SendMessage(struct sender *s, struct msg message)
 {
   struct pkt sendpkt;
   int i;
+  int slot;
 
-  /* if not blocked waiting on ACK */
-  if ( windowcount < WINDOWSIZE) {
-    if (TRACE > 1)
-      printf("----A: New message arrives, send window is not full, send new messge to layer3!\n");
+  /* create packet */
+  sendpkt.seqnum = (int)s->A_nextseqnum;
+  sendpkt.acknum = s->rto.adaptive ? 0 : NOTINUSE;  /* copies sent before, see rto.h */
+  for ( i=0; i<PAYLOADSIZE ; i++ ) 
+    sendpkt.payload[i] = message.data[i];
+  sendpkt.checksum = ComputeChecksum(&sendpkt); 
+
+  /* put packet in window buffer, after the last packet awaiting ACK */
+  slot = (s->windowfirst + s->windowcount) % s->windowsize;
+  s->buffer[slot] = sendpkt;
+  s->senttime[slot] = sim_time();
+  s->windowcount++;
+  s->windowsent++;
+
+  /* send out packet */
+  if (TRACING(1))
+    printf("Sending packet %u to layer 3\n", s->A_nextseqnum);
+  tolayer3 (A, sendpkt);
+
+  /* start timer if first packet in window */
+  if (s->windowcount == 1)
+    starttimer(A,s->rto.rto);
+
+  /* get next sequence number, wrap back to 0 */
+  s->A_nextseqnum = seq_next(s->A_nextseqnum, s->seqspace);
+}
+
+/* send the messages queued while the window was full, as far as it now has room */
+static void SendBacklog(struct sender *s)
+{
+  struct msg message;
 
-    /* create packet */
-    sendpkt.seqnum = A_nextseqnum;
-    sendpkt.acknum = NOTINUSE;
-    for ( i=0; i<20 ; i++ ) 
-      sendpkt.payload[i] = message.data[i];
-    sendpkt.checksum = ComputeChecksum(sendpkt); 
-
-    /* put packet in window buffer */
-    /* windowlast will always be 0 for alternating bit; but not for GoBackN */
-    windowlast = (windowlast + 1) % WINDOWSIZE; 
-    buffer[windowlast] = sendpkt;
-    windowcount++;
-
-    /* send out packet */
-    if (TRACE > 0)
-      printf("Sending packet %d to layer 3\n", sendpkt.seqnum);
-    tolayer3 (A, sendpkt);
-
-    /* start timer if first packet in window */
-    if (windowcount == 1)
-      starttimer(A,RTT);
-
-    /* get next sequence number, wrap back to 0 */
-    A_nextseqnum = (A_nextseqnum + 1) % SEQSPACE;  
+  while (s->windowcount < cwnd_window(&s->cwnd) && backlog_get(&s->backlog, &message)) {
+    if (TRACING(2))
+      printf("----A: send window has room, send queued message to layer3!\n");
+    SendMessage(s, message);
   }
-  /* if blocked,  window is full */
+}
+
+/* called from layer 5 (application layer), passed the message to be sent to other side */
+static void A_output(struct msg message)
+{
+  struct sender *s = sim_state(A, sizeof(struct sender));
+
+  /* if not blocked waiting on ACK, or by the congestion window, and no
+     earlier message is waiting to go first */
+  if ( s->windowcount < cwnd_window(&s->cwnd) && s->backlog.count == 0) {
+    if (TRACING(2))
+      printf("----A: New message arrives, send window is not full, send new messge to layer3!\n");
+    SendMessage(s, message);
+  }
+  /* if blocked, wait in the backlog */
+  else if (backlog_put(&s->backlog, message)) {
+    if (TRACING(1))
+      printf("----A: New message arrives, send window is full, message queued\n");
+  }
+  /* if blocked,  window and backlog are full */
   else {
-    if (TRACE > 0)
+    if (TRACING(1))
       printf("----A: New message arrives, send window is full\n");
-    window_full++;
+    sim_stats()->window_full++;
   }
 }
 
+/* true if A_output() would send or queue a message rather than refuse it */
+static int A_ready(void)
+{
+  struct sender *s = sim_state(A, sizeof(struct sender));
+
+  return (s->windowcount < cwnd_window(&s->cwnd) && s->backlog.count == 0)
+    || s->backlog.count < s->backlog.size;
+}
+
 
 /* called from layer 3, when a packet arrives for layer 4 
    In this practical this will always be an ACK as B never sends data.
 */
-void A_input(struct pkt packet)
+static void A_input(struct pkt packet)
 {
-  int ackcount = 0;
-  int i;
+  struct sender *s = sim_state(A, sizeof(struct sender));
+  unsigned int acknum = (unsigned int)packet.acknum;
+  long long ackcount;
+  int slot;
 
   /* if received ACK is not corrupted */ 
-  if (!IsCorrupted(packet)) {
-    if (TRACE > 0)
-      printf("----A: uncorrupted ACK %d is received\n",packet.acknum);
-    total_ACKs_received++;
-
-    /* check if new ACK or duplicate */
-    if (windowcount != 0) {
-          int seqfirst = buffer[windowfirst].seqnum;
-          int seqlast = buffer[windowlast].seqnum;
-          /* check case when seqnum has and hasn't wrapped */
-          if (((seqfirst <= seqlast) && (packet.acknum >= seqfirst && packet.acknum <= seqlast)) ||
-              ((seqfirst > seqlast) && (packet.acknum >= seqfirst || packet.acknum <= seqlast))) {
-
-            /* packet is a new ACK */
-            if (TRACE > 0)
-              printf("----A: ACK %d is not a duplicate\n",packet.acknum);
-            new_ACKs++;
-
-            /* cumulative acknowledgement - determine how many packets are ACKed */
-            if (packet.acknum >= seqfirst)
-              ackcount = packet.acknum + 1 - seqfirst;
-            else
-              ackcount = SEQSPACE - seqfirst + packet.acknum;
-
-	    /* slide window by the number of packets ACKed */
-            windowfirst = (windowfirst + ackcount) % WINDOWSIZE;
-
-            /* delete the acked packets from window buffer */
-            for (i=0; i<ackcount; i++)
-              windowcount--;
-
-	    /* start timer again if there are still more unacked packets in window */
-            stoptimer(A);
-            if (windowcount > 0)
-              starttimer(A, RTT);
-
-          }
-        }
-        else
-          if (TRACE > 0)
+  if (!IsCorrupted(&packet)) {
+    if (TRACING(1))
+      printf("----A: uncorrupted ACK %u is received\n", acknum);
+    sim_stats()->total_ACKs_received++;
+
+    /* cumulative acknowledgement - determine how many packets are ACKed;
+       it is a new ACK if that is some of the packets in the window */
+    ackcount = acknum < s->seqspace ? seq_diff(acknum, s->A_base, s->seqspace) + 1LL : 0;
+    if (ackcount > 0 && ackcount <= s->windowcount) {
+
+      /* packet is a new ACK */
+      if (TRACING(1))
+        printf("----A: ACK %u is not a duplicate\n", acknum);
+      sim_stats()->new_ACKs++;
+
+      /* time the round trip of the packet ACKed from the copy of it
+         the ACK echoes, if that is known (see rto.h) */
+      slot = (int)((s->windowfirst + ackcount - 1) % s->windowsize);
+      if (packet.seqnum == 0)
+        rto_sample(&s->rto, sim_time() - s->senttime[slot]);
+      else if (packet.seqnum == s->buffer[slot].acknum)
+        rto_sample(&s->rto, sim_time() - s->lastsent[slot]);
+      cwnd_ack(&s->cwnd, (int)ackcount);
+      NoteEstimates(s);
+
+      /* slide window by the number of packets ACKed, deleting them from the buffer */
+      s->windowfirst = (int)((s->windowfirst + ackcount) % s->windowsize);
+      s->windowcount -= (int)ackcount;
+      s->windowsent = s->windowsent > ackcount ? s->windowsent - (int)ackcount : 0;
+      s->A_base = seq_next(acknum, s->seqspace);
+      s->dupacks = 0;
+      s->recover -= ackcount;
+
+      /* start timer again if there are still more unacked packets in window */
+      stoptimer(A);
+      if (s->windowcount > 0)
+        starttimer(A, s->rto.rto);
+
+      /* resend what the go-back left waiting, then fill the room the
+         ACK made from the backlog */
+      ResendPending(s);
+      SendBacklog(s);
+    }
+    /* the receiver repeats its last ACK for every packet after a lost
+       one; enough of them and the window is resent at once */
+    else if (s->windowcount > 0 && seq_next(acknum, s->seqspace) == s->A_base &&
+             ++s->dupacks == s->dupthresh && s->recover <= 0) {
+      if (TRACING(1))
+        printf ("----A: %d duplicate ACKs received, fast retransmit!\n", s->dupacks);
+      sim_stats()->fast_retransmits++;
+      cwnd_loss(&s->cwnd, s->windowcount);
+      NoteEstimates(s);
+      stoptimer(A);
+      ResendWindow(s);
+    }
+    else
+      if (TRACING(1))
         printf ("----A: duplicate ACK received, do nothing!\n");
   }
   else 
-    if (TRACE > 0)
+    if (TRACING(1))
       printf ("----A: corrupted ACK is received, do nothing!\n");
 }
 
 /* called when A's timer goes off */
-void A_timerinterrupt(void)
+static void A_timerinterrupt(void)
 {
-  int i;
+  struct sender *s = sim_state(A, sizeof(struct sender));
 
-  if (TRACE > 0)
+  if (TRACING(1))
     printf("----A: time out,resend packets!\n");
+  sim_stats()->timeouts++;
+  rto_backoff(&s->rto);
+  cwnd_timeout(&s->cwnd, s->windowcount);
+  NoteEstimates(s);
 
-  for(i=0; i<windowcount; i++) {
-
-    if (TRACE > 0)
-      printf ("---A: resending packet %d\n", (buffer[(windowfirst+i) % WINDOWSIZE]).seqnum);
-
-    tolayer3(A,buffer[(windowfirst+i) % WINDOWSIZE]);
-    packets_resent++;
-    if (i==0) starttimer(A,RTT);
-  }
+  ResendWindow(s);
 }       
 
 
 
 /* the following routine will be called once (only) before any other */
 /* entity A routines are called. You can use it to do any initialization */
-void A_init(void)
+static void A_init(void)
 {
+  struct sender *s = sim_state(A, sizeof(struct sender));
+
   /* initialise A's window, buffer and sequence number */
-  A_nextseqnum = 0;  /* A starts with seq num 0, do not change this */
-  windowfirst = 0;
-  windowlast = -1;   /* windowlast is where the last packet sent is stored.  
-		     new packets are placed in winlast + 1 
-		     so initially this is set to -1
-		   */
-  windowcount = 0;
+  GetWindow(&s->windowsize, &s->seqspace);
+  s->buffer = sim_alloc(s->windowsize * sizeof(struct pkt));
+  s->senttime = sim_alloc(s->windowsize * sizeof(double));
+  s->lastsent = sim_alloc(s->windowsize * sizeof(double));
+  s->A_nextseqnum = 0;  /* A starts with seq num 0, do not change this */
+  s->A_base = 0;
+  s->windowfirst = 0;
+  s->windowcount = 0;
+  s->windowsent = 0;
+  s->dupacks = 0;
+  s->recover = 0;
+  s->dupthresh = sim_dupthresh();
+  rto_init(&s->rto, RTT, sim_adaptiverto(0));
+  cwnd_init(&s->cwnd, s->windowsize, sim_congestion());
+  backlog_init(&s->backlog, sim_backlog());
+  NoteEstimates(s);
 }
 
 
 
 /********* Receiver (B)  variables and procedures ************/
 
-static int expectedseqnum; /* the sequence number expected next by the receiver */
-static int B_nextseqnum;   /* the sequence number for the next packets sent by B */
+struct receiver {
+  unsigned int expectedseqnum; /* the sequence number expected next by the receiver */
+  int B_nextseqnum;   /* the sequence number for the next packets sent by B */
+  long long seqspace; /* sequence numbers in use */
+  int echo;           /* ACKs echo the copy count of their packet, see rto.h */
+  struct ackdelay ackdelay; /* ACKs held back */
+};
 
 
 /* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
+static void B_input(struct pkt packet)
 {
+  struct receiver *r = sim_state(B, sizeof(struct receiver));
   struct pkt sendpkt;
   int i;
+  bool inorder = false;
 
   /* if not corrupted and received packet is in order */
-  if  ( (!IsCorrupted(packet))  && (packet.seqnum == expectedseqnum) ) {
-    if (TRACE > 0)
-      printf("----B: packet %d is correctly received, send ACK!\n",packet.seqnum);
-    packets_received++;
+  if  ( (!IsCorrupted(&packet))  && ((unsigned int)packet.seqnum == r->expectedseqnum) ) {
+    if (TRACING(1))
+      printf("----B: packet %u is correctly received, send ACK!\n", r->expectedseqnum);
+    sim_stats()->packets_received++;
 
     /* deliver to receiving application */
     tolayer5(B, packet.payload);
 
     /* send an ACK for the received packet */
-    sendpkt.acknum = expectedseqnum;
+    sendpkt.acknum = (int)r->expectedseqnum;
 
     /* update state variables */
-    expectedseqnum = (expectedseqnum + 1) % SEQSPACE;        
+    r->expectedseqnum = seq_next(r->expectedseqnum, r->seqspace);
+    inorder = true;
   }
   else {
     /* packet is corrupted or out of order resend last ACK */
-    if (TRACE > 0) 
+    if (TRACING(1)) 
       printf("----B: packet corrupted or not expected sequence number, resend ACK!\n");
-    if (expectedseqnum == 0)
-      sendpkt.acknum = SEQSPACE - 1;
+    if (r->expectedseqnum == 0)
+      sendpkt.acknum = (int)(unsigned int)(r->seqspace - 1);
     else
-      sendpkt.acknum = expectedseqnum - 1;
+      sendpkt.acknum = (int)(r->expectedseqnum - 1);
   }
 
   /* create packet */
-  sendpkt.seqnum = B_nextseqnum;
-  B_nextseqnum = (B_nextseqnum + 1) % 2;
+  sendpkt.seqnum = r->B_nextseqnum;
+  r->B_nextseqnum = (r->B_nextseqnum + 1) % 2;
+  if (r->echo)
+    sendpkt.seqnum = inorder ? packet.acknum : NOTINUSE;
     
   /* we don't have any data to send.  fill payload with 0's */
-  for ( i=0; i<20 ; i++ ) 
+  for ( i=0; i<PAYLOADSIZE ; i++ ) 
     sendpkt.payload[i] = '0';  
 
   /* computer checksum */
-  sendpkt.checksum = ComputeChecksum(sendpkt); 
+  sendpkt.checksum = ComputeChecksum(&sendpkt); 
 
-  /* send out packet */
-  tolayer3 (B, sendpkt);
+  /* send out packet, or hold it back if it may be delayed */
+  if (inorder)
+    ackdelay_inorder(&r->ackdelay, sendpkt);
+  else
+    ackdelay_now(&r->ackdelay, sendpkt);
 }
 
 /* the following routine will be called once (only) before any other */
 /* entity B routines are called. You can use it to do any initialization */
-void B_init(void)
+static void B_init(void)
 {
-  expectedseqnum = 0;
-  B_nextseqnum = 1;
+  struct receiver *r = sim_state(B, sizeof(struct receiver));
+  int windowsize;
+
+  GetWindow(&windowsize, &r->seqspace);
+  r->expectedseqnum = 0;
+  r->B_nextseqnum = 1;
+  r->echo = sim_adaptiverto(0);
+  ackdelay_init(&r->ackdelay, sim_ackevery());
 }
 
 /******************************************************************************
@@ -264,12 +431,33 @@ void B_init(void)
  *****************************************************************************/
 
 /* Note that with simplex transfer from a-to-B, there is no B_output() */
-void B_output(struct msg message)  
+static void B_output(struct msg message)  
+{
+}
+
+static int B_ready(void)
 {
+  return 1;
 }
 
 /* called when B's timer goes off */
-void B_timerinterrupt(void)
+static void B_timerinterrupt(void)
 {
+  struct receiver *r = sim_state(B, sizeof(struct receiver));
+
+  ackdelay_timeout(&r->ackdelay);
 }
 
+const struct protocol gbn_protocol = {
+  .name = "gbn",
+  .A_init = A_init,
+  .B_init = B_init,
+  .A_input = A_input,
+  .B_input = B_input,
+  .A_output = A_output,
+  .A_timerinterrupt = A_timerinterrupt,
+  .B_output = B_output,
+  .B_timerinterrupt = B_timerinterrupt,
+  .A_ready = A_ready,
+  .B_ready = B_ready
+};
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "hist.h"
+
+/* position of the highest set bit of x, which must not be 0 */
+static int highbit(unsigned long long x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(x);
+#else
+  int n = 0;
+
+  if (x >> 32) { x >>= 32; n += 32; }
+  if (x >> 16) { x >>= 16; n += 16; }
+  if (x >> 8) { x >>= 8; n += 8; }
+  if (x >> 4) { x >>= 4; n += 4; }
+  if (x >> 2) { x >>= 2; n += 2; }
+  return n + (int)(x >> 1);
+#endif
+}
+
+/* counters 0 .. 2*HIST_SUB-1 hold the values below 2*HIST_SUB one tick
+   each; above that, power of two b (b >= 1) covers the values
+   [HIST_SUB << b, HIST_SUB << (b+1)) with HIST_SUB counters of 2^b ticks.
+   Setting the low bits keeps b at 0 for the small values. */
+static int histindex(unsigned long long t)
+{
+  int b = highbit(t | (2 * HIST_SUB - 1)) - HIST_SUBBITS;
+
+  return b * HIST_SUB + (int)(t >> b);
+}
+
+/* smallest tick value counted by counter i, and the width it covers */
+static unsigned long long histlow(int i, unsigned long long *width)
+{
+  int b = i / HIST_SUB - 1;
+
+  if (b < 1) {
+    *width = 1;
+    return i;
+  }
+  *width = 1ULL << b;
+  return (unsigned long long)(i - b * HIST_SUB) << b;
+}
+
+void hist_init(struct hist *h, double unit)
+{
+  h->unit = unit;
+  h->counts = calloc(HIST_NCOUNTS, sizeof(long long));
+  if (h->counts == NULL) {
+    printf("memory allocation for histogram failed.");
+    exit(EXIT_FAILURE);
+  }
+  h->n = 0;
+  h->sum = 0.0;
+  h->min = 0.0;
+  h->max = 0.0;
+}
+
+void hist_free(struct hist *h)
+{
+  free(h->counts);
+  h->counts = NULL;
+}
+
+void hist_add(struct hist *h, double v)
+{
+  double t = v / h->unit;
+
+  if (t < 0.0)
+    t = 0.0;
+  else if (t > 9.0e18)
+    t = 9.0e18;
+  h->counts[histindex((unsigned long long)t)]++;
+  if (h->n == 0 || v < h->min)
+    h->min = v;
+  if (h->n == 0 || v > h->max)
+    h->max = v;
+  h->n++;
+  h->sum += v;
+}
+
+double hist_quantile(const struct hist *h, double q)
+{
+  unsigned long long low, width;
+  long long rank, seen = 0;
+  double mid;
+  int i;
+
+  if (h->n == 0)
+    return 0.0;
+  rank = (long long)(q * h->n + 0.5);
+  if (rank < 1)
+    rank = 1;
+  if (rank > h->n)
+    rank = h->n;
+  for (i = 0; i < HIST_NCOUNTS; i++) {
+    seen += h->counts[i];
+    if (seen >= rank) {
+      /* report the middle of the counter's range, kept within the
+         extremes actually seen */
+      low = histlow(i, &width);
+      mid = (low + 0.5 * width) * h->unit;
+      if (mid > h->max)
+        return h->max;
+      return mid < h->min ? h->min : mid;
+    }
+  }
+  return h->max;
+}
+
+double hist_mean(const struct hist *h)
+{
+  return h->n > 0 ? h->sum / h->n : 0.0;
+}
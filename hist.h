@@ -0,0 +1,29 @@
+/* ******************************************************************
+   Log-linear histogram, in the style of HdrHistogram.
+
+   Values are counted in ticks of a fixed unit.  Each power of two of
+   ticks is split into HIST_SUB equal sub-buckets, so any recorded value
+   and any quantile is known to within 1/HIST_SUB (under 1%) of itself,
+   whatever its magnitude, and recording is a few integer operations.
+**********************************************************************/
+
+#define HIST_SUBBITS 7
+#define HIST_SUB     (1 << HIST_SUBBITS)      /* sub-buckets per power of two */
+#define HIST_NCOUNTS ((64 - HIST_SUBBITS + 1) * HIST_SUB)
+
+struct hist {
+  double unit;            /* value of one tick */
+  long long *counts;      /* HIST_NCOUNTS counters */
+  long long n;            /* values recorded */
+  double sum;             /* exact sum, for the mean */
+  double min, max;        /* exact extremes */
+};
+
+/* values are recorded to a resolution of unit */
+extern void hist_init(struct hist *h, double unit);
+extern void hist_free(struct hist *h);
+extern void hist_add(struct hist *h, double v);
+
+/* value below which a fraction q of the recorded values lie */
+extern double hist_quantile(const struct hist *h, double q);
+extern double hist_mean(const struct hist *h);
@@ -0,0 +1,145 @@
+/* ******************************************************************
+   Command-line driver for the emulator.
+
+   With no arguments the scenario is read interactively, as it always
+   has been.  Otherwise it is taken from the options, and -f runs a whole
+   file of scenarios back to back in this one process.
+**********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "emulator.h"
+#include "config.h"
+#include "sim.h"
+
+/* read the scenario from the user, the way the emulator always has */
+static void readconfig(struct simconfig *cfg)
+{
+  config_defaults(cfg);
+  cfg->corruptdirection = 0;
+  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
+  printf("Enter the number of messages to simulate: ");
+  scanf("%lld",&cfg->nsimmax);
+  printf("Enter  packet loss probability [enter 0.0 for no loss]:");
+  scanf("%f",&cfg->lossprob);
+  printf("Enter packet corruption probability [0.0 for no corruption]:");
+  scanf("%f",&cfg->corruptprob);
+  if (cfg->lossprob != 0.0 || cfg->corruptprob != 0.0) {
+    printf("If you want loss or corruption to only occur in one direction, choose the direction: 0 A->B, 1 A<-B, 2 A<->B (both directions) :");
+    scanf("%d",&cfg->corruptdirection);
+  }
+  printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
+  scanf("%f",&cfg->lambda);
+  printf("Enter TRACE:");
+  scanf("%d",&cfg->trace);
+}
+
+static void runscenario(const struct simconfig *cfg, FILE *results, FILE *json, int quiet)
+{
+  static int njson = 0;
+  struct sim *s = sim_create(cfg);
+
+  sim_run(s);
+  if (!quiet)
+    sim_report(s, stdout);
+  if (results != NULL) {
+    sim_writeresults(s, results);
+    fflush(results);
+  }
+  if (json != NULL) {
+    if (njson++ > 0)
+      fprintf(json, ",\n");
+    sim_writejson(s, json);
+    fflush(json);
+  }
+  sim_destroy(s);
+}
+
+int main(int argc, char **argv)
+{
+  struct simconfig base, cfg;
+  char line[CONFIG_LINESIZE];
+  const char *scenarios = NULL, *resultsname = NULL, *jsonname = NULL;
+  FILE *fp, *results = NULL, *json = NULL;
+  int quiet = 0, lineno = 0, i, used;
+
+  if (argc == 1) {
+    readconfig(&cfg);
+    runscenario(&cfg, NULL, NULL, 0);
+    return EXIT_SUCCESS;
+  }
+
+  config_defaults(&base);
+  for (i = 1; i < argc; i += used) {
+    used = config_option(&base, argv[i], i + 1 < argc ? argv[i + 1] : NULL);
+    if (used == 0 && strcmp(argv[i], "-q") == 0) {
+      quiet = 1;
+      used = 1;
+    }
+    else if (used == 0 && strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      scenarios = argv[i + 1];
+      used = 2;
+    }
+    else if (used == 0 && strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      resultsname = argv[i + 1];
+      used = 2;
+    }
+    else if (used == 0 && strcmp(argv[i], "-J") == 0 && i + 1 < argc) {
+      jsonname = argv[i + 1];
+      used = 2;
+    }
+    if (used <= 0) {
+      config_usage(stderr, argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (resultsname != NULL) {
+    results = strcmp(resultsname, "-") == 0 ? stdout : fopen(resultsname, "w");
+    if (results == NULL) {
+      perror(resultsname);
+      return EXIT_FAILURE;
+    }
+    sim_writeresultsheader(results);
+  }
+  if (jsonname != NULL) {
+    json = strcmp(jsonname, "-") == 0 ? stdout : fopen(jsonname, "w");
+    if (json == NULL) {
+      perror(jsonname);
+      return EXIT_FAILURE;
+    }
+    fprintf(json, "[\n");
+  }
+
+  if (scenarios == NULL)
+    runscenario(&base, results, json, quiet);
+  else {
+    fp = fopen(scenarios, "r");
+    if (fp == NULL) {
+      perror(scenarios);
+      return EXIT_FAILURE;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+      lineno++;
+      cfg = base;
+      switch (config_parseline(&cfg, line)) {
+      case 1:
+        runscenario(&cfg, results, json, quiet);
+        break;
+      case -1:
+        fprintf(stderr, "%s:%d: bad scenario\n", scenarios, lineno);
+        return EXIT_FAILURE;
+      }
+    }
+    fclose(fp);
+  }
+
+  if (results != NULL && results != stdout)
+    fclose(results);
+  if (json != NULL) {
+    fprintf(json, "\n]\n");
+    if (json != stdout)
+      fclose(json);
+  }
+  return EXIT_SUCCESS;
+}
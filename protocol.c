@@ -0,0 +1,22 @@
+#include <stdlib.h>
+#include <string.h>
+#include "emulator.h"
+#include "protocol.h"
+#include "gbn.h"
+#include "sr.h"
+
+const struct protocol *const protocols[] = {
+  &gbn_protocol,
+  &sr_protocol,
+  NULL
+};
+
+int protocol_find(const char *name)
+{
+  int i;
+
+  for (i = 0; protocols[i] != NULL; i++)
+    if (strcmp(protocols[i]->name, name) == 0)
+      return i;
+  return -1;
+}
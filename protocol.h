@@ -0,0 +1,34 @@
+/* ******************************************************************
+   Transport protocols the emulator can run.
+
+   A protocol is a table of its entry points.  The emulator calls them
+   for the simulation current in the calling thread, and the protocol
+   keeps its per-simulation state in sim_state() (see emulator.h), so
+   one binary can run any protocol, or several simulations with
+   different protocols at once.
+**********************************************************************/
+
+/* included for extension to bidirectional communication */
+#define BIDIRECTIONAL 0       /*  0 = A->B  1 =  A<->B */
+
+struct protocol {
+  const char *name;
+  void (*A_init)(void);
+  void (*B_init)(void);
+  void (*A_input)(struct pkt);
+  void (*B_input)(struct pkt);
+  void (*A_output)(struct msg);
+  void (*A_timerinterrupt)(void);
+  void (*B_output)(struct msg);
+  void (*B_timerinterrupt)(void);
+  /* true if A_output(), B_output() would take a message now, into the
+     window or the backlog, rather than count it as refused */
+  int (*A_ready)(void);
+  int (*B_ready)(void);
+};
+
+/* every protocol linked in, ending with NULL; the first is the default */
+extern const struct protocol *const protocols[];
+
+/* index in protocols[] of the named protocol, or -1 */
+extern int protocol_find(const char *name);
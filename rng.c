@@ -0,0 +1,169 @@
+#include "rng.h"
+
+/********************* XOSHIRO256** *******************/
+
+static unsigned long long splitmix64(unsigned long long *x)
+{
+  unsigned long long z = (*x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static unsigned long long rotl(unsigned long long x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static void xoshiro_seed(struct simrng *rng, unsigned int seed)
+{
+  unsigned long long x = seed;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    rng->s[i] = splitmix64(&x);
+}
+
+/* advance the state by 2^128 values */
+static void xoshiro_jump(struct simrng *rng)
+{
+  static const unsigned long long jump[4] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+  };
+  unsigned long long s0 = 0, s1 = 0, s2 = 0, s3 = 0, t;
+  int i, b;
+
+  for (i = 0; i < 4; i++)
+    for (b = 0; b < 64; b++) {
+      if (jump[i] & (1ULL << b)) {
+        s0 ^= rng->s[0];
+        s1 ^= rng->s[1];
+        s2 ^= rng->s[2];
+        s3 ^= rng->s[3];
+      }
+      t = rng->s[1] << 17;
+      rng->s[2] ^= rng->s[0];
+      rng->s[3] ^= rng->s[1];
+      rng->s[1] ^= rng->s[2];
+      rng->s[0] ^= rng->s[3];
+      rng->s[2] ^= t;
+      rng->s[3] = rotl(rng->s[3], 45);
+    }
+  rng->s[0] = s0;
+  rng->s[1] = s1;
+  rng->s[2] = s2;
+  rng->s[3] = s3;
+}
+
+static void xoshiro_refill(struct simrng *rng)
+{
+  unsigned long long s0 = rng->s[0], s1 = rng->s[1];
+  unsigned long long s2 = rng->s[2], s3 = rng->s[3];
+  unsigned long long result, t;
+  int i;
+
+  for (i = 0; i < RNG_BATCH; i++) {
+    result = rotl(s1 * 5, 7) * 9;
+    t = s1 << 17;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = rotl(s3, 45);
+    /* top 53 bits give a double uniform on [0,1) */
+    rng->batch[i] = (result >> 11) * (1.0 / 9007199254740992.0);
+  }
+  if (rng->antithetic)
+    for (i = 0; i < RNG_BATCH; i++)
+      rng->batch[i] = 1.0 - rng->batch[i];
+  rng->s[0] = s0;
+  rng->s[1] = s1;
+  rng->s[2] = s2;
+  rng->s[3] = s3;
+}
+
+/********************* GLIBC rand() *******************/
+
+static int compat_next(struct simrng *rng)
+{
+  unsigned int v;
+  int i = rng->i;
+
+  v = rng->r[(i + 34 - 31) % 34] + rng->r[(i + 34 - 3) % 34];
+  rng->r[i] = v;
+  rng->i = (i + 1) % 34;
+  return (int)(v >> 1);
+}
+
+static void compat_seed(struct simrng *rng, unsigned int seed)
+{
+  int i;
+  long hi, lo, word;
+
+  if (seed == 0)
+    seed = 1;
+  rng->r[0] = seed;
+  for (i = 1; i < 31; i++) {
+    /* r[i] = 16807 * r[i-1] % 2147483647, without overflowing 31 bits */
+    hi = (long)(int)rng->r[i - 1] / 127773;
+    lo = (long)(int)rng->r[i - 1] % 127773;
+    word = 16807 * lo - 2836 * hi;
+    if (word < 0)
+      word += 2147483647;
+    rng->r[i] = (unsigned int)word;
+  }
+  for (i = 31; i < 34; i++)
+    rng->r[i] = rng->r[i - 31];
+  rng->i = 0;
+
+  /* the first 310 values of the recurrence are discarded */
+  for (i = 0; i < 310; i++)
+    compat_next(rng);
+}
+
+static void compat_refill(struct simrng *rng)
+{
+  double mmm = RNG_COMPAT_MAX;
+  int i;
+
+  for (i = 0; i < RNG_BATCH; i++)
+    rng->batch[i] = compat_next(rng) / mmm;
+  if (rng->antithetic)
+    for (i = 0; i < RNG_BATCH; i++)
+      rng->batch[i] = 1.0 - rng->batch[i];
+}
+
+/********************* INTERFACE **********************/
+
+/* the compat generator has no jump function: stream is ignored, so
+   every stream started from one seed produces the same sequence */
+void rng_seed(struct simrng *rng, int kind, unsigned int seed, int stream)
+{
+  rng->kind = kind;
+  if (kind == RNG_COMPAT)
+    compat_seed(rng, seed);
+  else {
+    xoshiro_seed(rng, seed);
+    while (stream-- > 0)
+      xoshiro_jump(rng);
+  }
+  rng->next = RNG_BATCH;
+  rng->antithetic = 0;
+}
+
+void rng_refill(struct simrng *rng)
+{
+  if (rng->kind == RNG_COMPAT)
+    compat_refill(rng);
+  else
+    xoshiro_refill(rng);
+  rng->next = 0;
+}
+
+const char *rng_name(int kind)
+{
+  return kind == RNG_COMPAT ? "rand" : "xoshiro";
+}
@@ -0,0 +1,56 @@
+/* ******************************************************************
+   Random number generators owned by one simulation.
+
+   RNG_XOSHIRO is xoshiro256** (Blackman and Vigna), seeded through
+   splitmix64.  It is the default: fast, with good statistical quality
+   and a 2^256 - 1 period.
+
+   RNG_COMPAT is the additive feedback generator behind the C library's
+   rand() on glibc systems (TYPE_3, x[i] = x[i-3] + x[i-31]).  Seeded
+   with the same value it produces exactly the sequence rand() does after
+   srand(), so results of earlier versions of the emulator, which used
+   rand() seeded with 9999, can be reproduced.
+
+   A simulation draws each stochastic process from its own stream.  With
+   RNG_XOSHIRO stream k starts 2^128 * k values into the sequence for the
+   seed (the generator's jump function), so streams never overlap.
+
+   With antithetic set every uniform u is replaced by 1 - u; pairing a
+   run with its antithetic twin gives negatively correlated results,
+   whose average has a lower variance than two independent runs.
+
+   Uniforms are generated RNG_BATCH at a time into a buffer that the
+   simulation then consumes, which keeps the generator's inner loop tight
+   and out of the emulator's hot path.
+**********************************************************************/
+
+#define RNG_XOSHIRO     0
+#define RNG_COMPAT      1
+
+#define RNG_COMPAT_MAX  2147483647      /* RAND_MAX of the glibc generator */
+#define RNG_BATCH       64
+
+struct simrng {
+  int kind;                     /* RNG_XOSHIRO or RNG_COMPAT */
+  unsigned long long s[4];      /* xoshiro256** state */
+  unsigned int r[34];           /* compat: the last 34 values of the recurrence */
+  int i;                        /* compat: index of the next value in r[] */
+  double batch[RNG_BATCH];      /* uniforms generated but not yet used */
+  int next;                     /* index of the next unused uniform */
+  int antithetic;               /* hand out 1 - u instead of u */
+};
+
+extern void rng_seed(struct simrng *rng, int kind, unsigned int seed, int stream);
+
+/* refill the batch; called by rng_uniform() when it has run dry */
+extern void rng_refill(struct simrng *rng);
+
+/* next uniform in [0,1] (RNG_COMPAT) or [0,1) (RNG_XOSHIRO) */
+static inline double rng_uniform(struct simrng *rng)
+{
+  if (rng->next == RNG_BATCH)
+    rng_refill(rng);
+  return rng->batch[rng->next++];
+}
+
+extern const char *rng_name(int kind);
@@ -0,0 +1,52 @@
+#include "rto.h"
+
+void rto_init(struct rto *r, double initial, int adaptive)
+{
+  r->adaptive = adaptive;
+  r->measured = 0;
+  r->srtt = 0.0;
+  r->rttvar = 0.0;
+  r->measuredrto = initial;
+  r->rto = initial;
+}
+
+void rto_sample(struct rto *r, double rtt)
+{
+  double err;
+
+  if (!r->adaptive)
+    return;
+  if (!r->measured) {
+    r->srtt = rtt;
+    r->rttvar = rtt / 2;
+    r->measured = 1;
+  }
+  else {
+    /* gains of 1/4 and 1/8; the deviation uses the old SRTT */
+    err = rtt - r->srtt;
+    r->rttvar += ((err < 0 ? -err : err) - r->rttvar) / 4;
+    r->srtt += err / 8;
+  }
+  /* a fresh measurement also ends any backoff */
+  r->measuredrto = r->srtt + 4 * r->rttvar;
+  if (r->measuredrto < RTO_MIN)
+    r->measuredrto = RTO_MIN;
+  r->rto = r->measuredrto;
+}
+
+static double ceiling(const struct rto *r)
+{
+  return RTO_BACKOFF * r->measuredrto > RTO_MAX ? RTO_BACKOFF * r->measuredrto : RTO_MAX;
+}
+
+void rto_backoff(struct rto *r)
+{
+  if (!r->adaptive)
+    return;
+  r->rto = rto_next(r, r->rto);
+}
+
+double rto_next(const struct rto *r, double timeout)
+{
+  return 2 * timeout < ceiling(r) ? 2 * timeout : ceiling(r);
+}
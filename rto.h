@@ -0,0 +1,52 @@
+/* ******************************************************************
+   Retransmission timeout estimation, after RFC 6298.
+
+   Round trip times measured on ACKs feed a smoothed RTT and a mean
+   deviation (Jacobson/Karels), and the timeout is SRTT + 4 * RTTVAR, at
+   least RTO_MIN.  The measured timeout is never capped: a busy channel
+   makes round trips of hundreds of time units, and a timeout below them
+   only resends packets that are still on their way.  Each timeout
+   doubles it until the next measurement, up to RTO_MAX or RTO_BACKOFF
+   times the measured timeout, whichever is larger.
+
+   An ACK of a resent packet cannot tell by itself which copy it
+   answers, so Karn's rule would leave it unmeasured.  After a timeout
+   Go-Back-N resends every packet in flight, and under steady loss it
+   could then go many rounds without a measurement, idling through the
+   backed-off timeout each time.  Instead, as with the TCP timestamp
+   option (RFC 7323), while the timeout is adaptive a data packet's
+   unused acknum counts the times it was sent before, and the receiver
+   echoes that count in the seqnum of the ACK the packet draws (NOTINUSE
+   when the ACK answers no packet in particular).  The sender times the
+   ACK from the first send if the echo is 0, or from the latest resend
+   if it matches the packet's count; any other echo is ambiguous.
+
+   When not adaptive the timeout stays at its initial value, which is
+   how the protocols behaved before estimation was added.
+**********************************************************************/
+
+#define RTO_MIN 2.0       /* the shortest possible round trip: one time unit per hop */
+#define RTO_MAX 1024.0    /* backoff ceiling: 64 times the protocols' fixed timeout */
+#define RTO_BACKOFF 64.0  /* backoff ceiling relative to the measured timeout */
+
+struct rto {
+  int adaptive;           /* estimate the timeout, else keep it fixed */
+  int measured;           /* at least one RTT has been measured */
+  double srtt;            /* smoothed round trip time */
+  double rttvar;          /* smoothed mean deviation of the round trip time */
+  double measuredrto;     /* the timeout given by the measurements, before backoff */
+  double rto;             /* the current timeout */
+};
+
+extern void rto_init(struct rto *r, double initial, int adaptive);
+
+/* account for a round trip time measured on a packet sent once */
+extern void rto_sample(struct rto *r, double rtt);
+
+/* a timeout expired: back off */
+extern void rto_backoff(struct rto *r);
+
+/* the timeout for a timer that expired after timeout: twice as long, up
+   to the backoff ceiling.  Unlike rto_backoff() this also backs off a
+   fixed timeout, for a sender that keeps a timer per packet. */
+extern double rto_next(const struct rto *r, double timeout);
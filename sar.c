@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "emulator.h"
+#include "sar.h"
+
+static void put32(char *p, unsigned int v)
+{
+  int i;
+
+  for (i = 0; i < 4; i++)
+    p[i] = (char)(v >> (8 * i));
+}
+
+static unsigned int get32(const char *p)
+{
+  unsigned int v = 0;
+  int i;
+
+  for (i = 3; i >= 0; i--)
+    v = (v << 8) | (unsigned char)p[i];
+  return v;
+}
+
+void sar_init(struct sar *s, long long maxsize, int mtu)
+{
+  s->maxsize = maxsize;
+  s->mtu = mtu;
+  s->queue = NULL;
+  s->first = 0;
+  s->count = 0;
+  s->buf = NULL;
+  s->id = 0;
+  s->have = -1;
+  if (maxsize > 0) {
+    s->queue = malloc(SAR_QUEUE * sizeof(struct sarmsg));
+    s->buf = malloc(maxsize);
+    if (s->queue == NULL || s->buf == NULL) {
+      printf("memory allocation for message segmentation failed.");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+void sar_free(struct sar *s)
+{
+  free(s->queue);
+  free(s->buf);
+}
+
+int sar_put(struct sar *s, unsigned int id, int entity, long long size, char fill)
+{
+  struct sarmsg *q;
+
+  if (s->count == SAR_QUEUE)
+    return 0;
+  q = &s->queue[(s->first + s->count) % SAR_QUEUE];
+  q->id = id;
+  q->entity = entity;
+  q->size = size;
+  q->offset = 0;
+  q->fill = fill;
+  s->count++;
+  return 1;
+}
+
+const struct sarmsg *sar_head(const struct sar *s)
+{
+  return s->count > 0 ? &s->queue[s->first] : NULL;
+}
+
+void sar_next(struct sar *s, struct msg *m)
+{
+  struct sarmsg *q = &s->queue[s->first];
+  int n = q->size - q->offset < s->mtu - SAR_HEADER ? (int)(q->size - q->offset) : s->mtu - SAR_HEADER;
+
+  put32(m->data, q->id);
+  put32(m->data + 4, (unsigned int)q->offset);
+  m->data[8] = (char)(n & 0xff);
+  m->data[9] = (char)(n >> 8);
+  m->data[10] = q->offset + n == q->size ? SAR_LAST : 0;
+  m->data[11] = 0;
+  memset(m->data + SAR_HEADER, q->fill, n);
+  memset(m->data + SAR_HEADER + n, 0, sizeof(m->data) - SAR_HEADER - n);
+  q->offset += n;
+  if (q->offset == q->size) {
+    s->first = (s->first + 1) % SAR_QUEUE;
+    s->count--;
+  }
+}
+
+long long sar_receive(struct sar *s, const char *data)
+{
+  unsigned int id = get32(data);
+  long long offset = get32(data + 4);
+  int n = (unsigned char)data[8] | (unsigned char)data[9] << 8;
+
+  /* a first segment starts a new message, dropping any broken one; any
+     other segment must continue the message being collected */
+  if (offset == 0) {
+    s->id = id;
+    s->have = 0;
+  }
+  else if (s->have < 0 || id != s->id || offset != s->have) {
+    s->have = -1;
+    return 0;
+  }
+  if (offset + n > s->maxsize || n > s->mtu - SAR_HEADER) {
+    s->have = -1;
+    return 0;
+  }
+
+  memcpy(s->buf + offset, data + SAR_HEADER, n);
+  s->have += n;
+  if (!(data[10] & SAR_LAST))
+    return 0;
+  s->have = -1;
+  return offset + n;
+}
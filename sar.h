@@ -0,0 +1,75 @@
+/* ******************************************************************
+   Segmentation and reassembly of large messages.
+
+   With a message size set (-M), layer 5 hands over messages of that many
+   bytes instead of one struct msg at a time, or of a size drawn for each
+   message from a range.  At A each message is cut into segments of at
+   most mtu - SAR_HEADER bytes of data, each one struct msg passed to the
+   protocol's A_output() in turn, so a message takes consecutive sequence
+   numbers.  At B the segments the protocol delivers are collected, and
+   the message is delivered to the application once, when its last
+   segment arrives.
+
+   Each segment starts with a header of SAR_HEADER bytes:
+     bytes 0-3    message number, least significant byte first
+     bytes 4-7    offset of the segment's data in the message
+     bytes 8-9    bytes of data in the segment
+     byte  10     flags: SAR_LAST on the message's last segment
+     byte  11     unused, 0
+
+   Messages wait in a queue of SAR_QUEUE messages until their segments
+   are sent.  A segment is only offered to the protocol when it can take
+   it (its A_ready()), and the rest of the queue is sent as ACKs open the
+   window, so a message is lost only if it finds the queue full.
+
+   GBN and SR deliver in order without gaps, so reassembly only checks
+   that each segment continues the message being collected; B throws
+   away a message that does not, when the next one begins.
+
+   The payload of a packet, and so the mtu, is at most PAYLOADSIZE bytes
+   (emulator.h), set when building: e.g. make PAYLOADSIZE=1500.
+**********************************************************************/
+
+#define SAR_HEADER  12
+#define SAR_LAST    1
+#define SAR_MAXMSG  (1LL << 30)     /* largest message size */
+#define SAR_MAXMTU  65535           /* largest mtu the length field allows */
+#define SAR_QUEUE   1024            /* messages waiting to be segmented */
+
+/* a message waiting in the queue */
+struct sarmsg {
+  unsigned int id;        /* message number */
+  int entity;             /* the sender, A or B */
+  long long size;         /* bytes in the message */
+  long long offset;       /* bytes of it already segmented */
+  char fill;              /* the byte its data is made of */
+};
+
+struct sar {
+  long long maxsize;      /* largest message, 0 for no segmentation */
+  int mtu;                /* payload bytes used per packet */
+  struct sarmsg *queue;   /* ring of SAR_QUEUE messages */
+  int first;              /* ring index of the oldest message */
+  int count;              /* messages queued */
+  char *buf;              /* the message being reassembled at B */
+  unsigned int id;        /* its number */
+  long long have;         /* bytes of it collected, -1 for none */
+};
+
+extern void sar_init(struct sar *s, long long maxsize, int mtu);
+extern void sar_free(struct sar *s);
+
+/* queue message id of size bytes of fill from entity; returns 0 if the
+   queue is full */
+extern int sar_put(struct sar *s, unsigned int id, int entity, long long size, char fill);
+
+/* the oldest queued message, or NULL if there is none */
+extern const struct sarmsg *sar_head(const struct sar *s);
+
+/* fill *m with the next segment of the oldest queued message, taking
+   the message out of the queue with its last segment */
+extern void sar_next(struct sar *s, struct msg *m);
+
+/* a segment delivered at B; returns the size of the message it
+   completes, or 0 if it does not complete one */
+extern long long sar_receive(struct sar *s, const char *data);
@@ -0,0 +1,54 @@
+/* ******************************************************************
+   Simulation context.
+
+   A struct sim holds everything one run of the emulator needs: its
+   configuration, clock, event list, random number generator, timers,
+   statistics and the protocol's state.  Simulations are independent, so
+   any number may exist at once and different threads may run different
+   simulations concurrently.
+**********************************************************************/
+
+struct sim;
+
+extern struct sim *sim_create(const struct simconfig *cfg);
+extern void sim_destroy(struct sim *s);
+
+/* run the simulation until no events are left */
+extern void sim_run(struct sim *s);
+
+/* call fn(arg) with s as the calling thread's current simulation, so
+   that fn may use the routines of emulator.h outside sim_run() */
+extern void sim_call(struct sim *s, void (*fn)(void *), void *arg);
+
+extern const struct simstats *sim_getstats(const struct sim *s);
+extern double sim_endtime(const struct sim *s);
+
+/* number of events scheduled so far */
+extern long long sim_events(const struct sim *s);
+
+/* figures derived from a finished run */
+struct simmetrics {
+  /* end-to-end latency of the delivered messages, from entering layer 4
+     at the sender to delivery to layer 5 at the receiver */
+  long long latency_count;
+  double latency_mean, latency_p50, latency_p99, latency_p999, latency_max;
+  double goodput;             /* messages delivered per time unit */
+  double goodput_bytes;       /* bytes of them delivered per time unit */
+  double utilization[2];      /* share of the time the channel towards A,
+                                 B carried at least one packet */
+  double resend_overhead;     /* packets resent per message accepted */
+  double backlog_depth;       /* mean number of messages waiting in the sender's backlog */
+  double backlog_wait;        /* mean time a message sent from the backlog waited */
+};
+
+extern void sim_getmetrics(const struct sim *s, struct simmetrics *m);
+
+/* end-of-run text report */
+extern void sim_report(const struct sim *s, FILE *fp);
+
+/* one CSV row of results per simulation */
+extern void sim_writeresultsheader(FILE *fp);
+extern void sim_writeresults(const struct sim *s, FILE *fp);
+
+/* the same results, and the metrics, as one JSON object */
+extern void sim_writejson(const struct sim *s, FILE *fp);
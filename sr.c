@@ -3,7 +3,14 @@
 #include <string.h>
 #include <stdbool.h>
 #include "emulator.h"
+#include "protocol.h"
 #include "sr.h"
+#include "window.h"
+#include "rto.h"
+#include "cwnd.h"
+#include "backlog.h"
+#include "ackdelay.h"
+#include "checksum.h"
 
 /* ******************************************************************
    Go Back N protocol.  Adapted from J.F.Kurose
@@ -21,299 +28,536 @@
    - removed bidirectional GBN code and other code not used by prac. 
    - fixed C style to adhere to current programming style
    - added GBN implementation
+   - window size and sequence space set at run time (-w, -S), with
+   32-bit serial number arithmetic and bitmaps of ACKed and received
+   packets for windows of any size
+   - a retransmission timer per packet (settimer() in emulator.h), so
+   each lost packet is resent as soon as its own timer expires
+   - retransmission timeout estimated from measured round trip times
+   unless -R 0 fixes it, see rto.h; a window of per-packet timers at a
+   fixed timeout shorter than the round trip resends packets still on
+   their way
+   - optional congestion window limiting the packets in flight (-C),
+   see cwnd.h
+   - optional backlog of messages waiting for room in the window (-B),
+   see backlog.h
+   - optional selective acknowledgements (-K): every ACK also carries
+   the receiver's cumulative point and a bitmap of the packets it holds
+   after it, so one ACK that gets through covers those whose own ACKs
+   were lost
+   - optional delayed ACKs, one for every few packets received in order
+   (-A), see ackdelay.h; as one ACK must stand for several, they carry
+   the SACK payload even without -K
 **********************************************************************/
 
-#define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment */
-#define WINDOWSIZE 6    /* the maximum number of buffered unacked packet */
-#define SEQSPACE 12     /* the min sequence space for GBN must be at least windowsize + 1 */
+#define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment;
+                           the initial timeout, and the only one unless it is adaptive */
+#define WINDOWSIZE 6    /* the default maximum number of buffered unacked packet */
+#define SEQSPACE 12     /* the min sequence space for SR must be at least 2 * windowsize */
 #define NOTINUSE (-1)   /* used to fill header fields that are not being used */
-#define SENT 1
-#define ACKED 2
+#define SACKBITS 128    /* packets after the cumulative point reported in a SACK */
 /* generic procedure to compute the checksum of a packet.  Used by both sender and receiver  
    the simulator will overwrite part of your packet with 'z's.  It will not overwrite your 
    original checksum.  This procedure must generate a different checksum to the original if
-   the packet is corrupted.
+   the packet is corrupted.  The algorithm is chosen at run time (-e), see checksum.h.
 */
-int ComputeChecksum(struct pkt packet)
+static int ComputeChecksum(const struct pkt *packet)
 {
-  int checksum = 0;
-  int i;
-
-  checksum = packet.seqnum;
-  checksum += packet.acknum;
-  for ( i=0; i<20; i++ ) 
-    checksum += (int)(packet.payload[i]);
-
-  return checksum;
+  return checksum_pkt(sim_checksum(), packet);
 }
 
-bool IsCorrupted(struct pkt packet)
+static bool IsCorrupted(const struct pkt *packet)
 {
-  if (packet.checksum == ComputeChecksum(packet))
+  if (packet->checksum == ComputeChecksum(packet))
     return (false);
   else
     return (true);
 }
 
-bool IsSeqNumInWindow(int x, int seqnum) {
-    return ((seqnum >= x && seqnum < x + WINDOWSIZE) ||
-            (x + WINDOWSIZE >= SEQSPACE && (seqnum < (x + WINDOWSIZE) % SEQSPACE)));
+/* SACK payload of an ACK, covered by its checksum: bytes 0-3 hold the
+   receiver's cumulative point, the next sequence number it expects, least
+   significant byte first; bit i of bytes 4-19 is set if it holds packet
+   cumulative point + 1 + i */
+static unsigned int SackCumulative(const struct pkt *packet)
+{
+  unsigned int cum = 0;
+  int i;
+
+  for (i = 3; i >= 0; i--)
+    cum = (cum << 8) | (unsigned char)packet->payload[i];
+  return cum;
+}
+
+static int SackHeld(const struct pkt *packet, int i)
+{
+  return ((unsigned char)packet->payload[4 + i / 8] >> (i % 8)) & 1;
+}
+
+/* window size and sequence space of the current simulation.  By default
+   a window larger than WINDOWSIZE gets the full 32-bit sequence space. */
+static void GetWindow(int *windowsize, long long *seqspace)
+{
+  *windowsize = sim_window(WINDOWSIZE);
+  *seqspace = sim_seqspace(*windowsize <= WINDOWSIZE ? SEQSPACE : SEQSPACE32);
+  if (*seqspace < 2LL * *windowsize) {
+    printf("SR: a window of %d packets needs a sequence space of at least %lld.\n",
+           *windowsize, 2LL * *windowsize);
+    exit(EXIT_FAILURE);
   }
+}
 
 /********* Sender (A) variables and functions ************/
 
-static struct pkt buffer[WINDOWSIZE];  /* array for storing packets waiting for ACK */
-static int windowcount;                /* the number of packets currently awaiting an ACK */
-static int A_nextseqnum;               /* the next sequence number to be used by the sender */
-static int sender_base;
-static int timers[WINDOWSIZE];
-static bool acked[WINDOWSIZE];
+struct sender {
+  struct pkt *buffer;             /* ring of windowsize packets, the oldest at windowfirst */
+  unsigned long long *acked;      /* bitmap over the ring: packet has been ACKed */
+  unsigned long long *pending;    /* bitmap over the ring: timed out, to be resent
+                                     once the congestion window reaches it */
+  int npending;                   /* packets marked in pending */
+  timerhandle *timers;            /* retransmission timer of each packet in the ring */
+  double *timeout;                /* the timeout each packet's timer was last set to */
+  double *senttime;               /* when each packet in the ring was first sent */
+  double *lastsent;               /* when each packet in the ring was last resent */
+  int windowfirst;                /* ring index of the packet with sequence number sender_base */
+  int windowcount;                /* the number of packets currently awaiting an ACK */
+  unsigned int A_nextseqnum;      /* the next sequence number to be used by the sender */
+  unsigned int sender_base;       /* sequence number of the oldest packet awaiting ACK */
+  int windowsize;                 /* send window in use */
+  long long seqspace;             /* sequence numbers in use */
+  struct rto rto;                 /* retransmission timeout */
+  struct cwnd cwnd;               /* congestion window */
+  struct backlog backlog;         /* messages waiting for room in the window */
+  int sack;                       /* ACKs carry a SACK payload */
+};
+
+/* make the current timeout and congestion window part of the run's statistics */
+static void NoteEstimates(struct sender *s)
+{
+  sim_stats()->rto = s->rto.rto;
+  sim_stats()->srtt = s->rto.srtt;
+  sim_stats()->cwnd = s->cwnd.cwnd;
+}
 
-/* called from layer 5 (application layer), passed the message to be sent to other side */
-void A_output(struct msg message)
+/* put message in a packet, keep it in the window buffer and send it */
+static void SendMessage(struct sender *s, struct msg message)
 {
   struct pkt sendpkt;
   int i;
   int BUFFER_INDEX;
 
-  /* if not blocked waiting on ACK */
-  if ( windowcount < WINDOWSIZE) {
-    if (TRACE > 1)
-      printf("----A: New message arrives, send window is not full, send new message to layer3!\n");
+  /* create packet */
+  sendpkt.seqnum = (int)s->A_nextseqnum;
+  sendpkt.acknum = s->rto.adaptive ? 0 : NOTINUSE;  /* copies sent before, see rto.h */
+  for ( i=0; i<PAYLOADSIZE ; i++ ) 
+    sendpkt.payload[i] = message.data[i];
+  sendpkt.checksum = ComputeChecksum(&sendpkt); 
+
+  /* put packet in window buffer, after the last packet awaiting ACK */
+  BUFFER_INDEX = (s->windowfirst + s->windowcount) % s->windowsize;
+  s->buffer[BUFFER_INDEX]=sendpkt;
+  bit_clear(s->acked, BUFFER_INDEX);
+  s->senttime[BUFFER_INDEX] = sim_time();
+
+  /* send out packet */
+  if (TRACING(1))
+    printf("Sending packet %u to layer 3\n", s->A_nextseqnum);
+  tolayer3 (A, sendpkt);
+
+  /* start the packet's own timer, tagged with its place in the buffer */
+  s->timeout[BUFFER_INDEX] = s->rto.rto;
+  s->timers[BUFFER_INDEX] = settimer(A, s->rto.rto, BUFFER_INDEX);
+  s->windowcount++;
+
+  /* get next sequence number, wrap back to 0 */
+  s->A_nextseqnum = seq_next(s->A_nextseqnum, s->seqspace);
+}
+
+/* send the messages queued while the window was full, as far as it now has room */
+static void SendBacklog(struct sender *s)
+{
+  struct msg message;
+
+  while (s->windowcount < cwnd_window(&s->cwnd) && backlog_get(&s->backlog, &message)) {
+    if (TRACING(2))
+      printf("----A: send window has room, send queued message to layer3!\n");
+    SendMessage(s, message);
+  }
+}
 
-    /* create packet */
-    sendpkt.seqnum = A_nextseqnum;
-    sendpkt.acknum = NOTINUSE;
-    for ( i=0; i<20 ; i++ ) 
-      sendpkt.payload[i] = message.data[i];
-    sendpkt.checksum = ComputeChecksum(sendpkt); 
-
-    /* put packet in window buffer */
-    BUFFER_INDEX = A_nextseqnum % WINDOWSIZE;
-    buffer[BUFFER_INDEX]=sendpkt;
-    acked[BUFFER_INDEX]=false;
-
-    /* send out packet */
-    if (TRACE > 0)
-      printf("Sending packet %d to layer 3\n", sendpkt.seqnum);
-    tolayer3 (A, sendpkt);
-
-    /* start timer if first packet in window */
-    timers[BUFFER_INDEX]=A_nextseqnum;
-    starttimer(A,RTT);
-    windowcount++;
-
-    /* get next sequence number, wrap back to 0 */
-    A_nextseqnum = (A_nextseqnum + 1) % SEQSPACE;  
+/* called from layer 5 (application layer), passed the message to be sent to other side */
+static void A_output(struct msg message)
+{
+  struct sender *s = sim_state(A, sizeof(struct sender));
+
+  /* if not blocked waiting on ACK, or by the congestion window, and no
+     earlier message is waiting to go first */
+  if ( s->windowcount < cwnd_window(&s->cwnd) && s->backlog.count == 0) {
+    if (TRACING(2))
+      printf("----A: New message arrives, send window is not full, send new message to layer3!\n");
+    SendMessage(s, message);
+  }
+  /* if blocked, wait in the backlog */
+  else if (backlog_put(&s->backlog, message)) {
+    if (TRACING(1))
+      printf("----A: New message arrives, send window is full, message queued\n");
   }
-  /* if blocked,  window is full */
+  /* if blocked,  window and backlog are full */
   else {
-    if (TRACE > 0)
+    if (TRACING(1))
       printf("----A: New message arrives, send window is full\n");
-    window_full++;
+    sim_stats()->window_full++;
   }
 }
 
+/* true if A_output() would send or queue a message rather than refuse it */
+static int A_ready(void)
+{
+  struct sender *s = sim_state(A, sizeof(struct sender));
+
+  return (s->windowcount < cwnd_window(&s->cwnd) && s->backlog.count == 0)
+    || s->backlog.count < s->backlog.size;
+}
+
+
+/* mark the packet at offset in the window ACKed and cancel its
+   retransmission; returns 1 if it was not ACKed already */
+static int AckPacket(struct sender *s, long long offset)
+{
+    int index = (int)((s->windowfirst + offset) % s->windowsize);
+
+    if (bit_test(s->acked, index))
+        return 0;
+    bit_set(s->acked, index);
+    if (bit_test(s->pending, index)) {
+        bit_clear(s->pending, index);
+        s->npending--;
+    }
+    canceltimer(s->timers[index]);
+    s->timers[index] = NOTIMER;
+    return 1;
+}
+
+/* mark every packet of the window the SACK payload of packet reports as
+   received; returns the number of packets newly ACKed */
+static int AckSelective(struct sender *s, const struct pkt *packet)
+{
+    unsigned int cum = SackCumulative(packet);
+    long long start;    /* offset of the cumulative point in the window */
+    long long offset;
+    int i;
+    int nacked = 0;
+
+    if (cum >= s->seqspace)
+        return 0;
+    start = seq_diff(cum, s->sender_base, s->seqspace);
+    if (start > s->seqspace / 2)
+        start -= s->seqspace;       /* an old ACK, from behind sender_base */
+
+    /* everything before the cumulative point; those packets leave the
+       window below, so each is visited once */
+    for (offset = 0; offset < start && offset < s->windowcount; offset++)
+        nacked += AckPacket(s, offset);
+
+    for (i = 0; i < SACKBITS && start + 1 + i < s->windowcount; i++) {
+        offset = start + 1 + i;
+        if (offset >= 0 && SackHeld(packet, i))
+            nacked += AckPacket(s, offset);
+    }
+
+    if (TRACING(2))
+        printf("----A: SACK up to %u, %d more packets ACKed\n", cum, nacked);
+    return nacked;
+}
+
+/* resend the packet at index and set its timer again */
+static void ResendPacket(struct sender *s, int index)
+{
+    if (TRACING(1))
+        printf("----A: resend packet %u!\n", (unsigned int)s->buffer[index].seqnum);
+
+    /* count the copy, for the receiver to echo (see rto.h) */
+    if (s->rto.adaptive) {
+        s->buffer[index].acknum++;
+        s->buffer[index].checksum = ComputeChecksum(&s->buffer[index]);
+    }
+    tolayer3(A, s->buffer[index]);
+    s->lastsent[index] = sim_time();
+    sim_stats()->packets_resent++;
+
+    /* a fixed timeout does not back off, so each packet backs off its
+       own timer: one queued behind others on the channel would otherwise
+       time out again and again before its ACK could return */
+    s->timeout[index] = s->rto.adaptive ? s->rto.rto : rto_next(&s->rto, s->timeout[index]);
+    s->timers[index] = settimer(A, s->timeout[index], index);
+}
+
+/* resend the timed-out packets the congestion window now reaches */
+static void ResendPending(struct sender *s)
+{
+    int n = cwnd_window(&s->cwnd) < s->windowcount ? cwnd_window(&s->cwnd) : s->windowcount;
+    int i;
+    int index;
+
+    for (i = 0; i < n && s->npending > 0; i++) {
+        index = (s->windowfirst + i) % s->windowsize;
+        if (bit_test(s->pending, index)) {
+            bit_clear(s->pending, index);
+            s->npending--;
+            ResendPacket(s, index);
+        }
+    }
+}
 
 /* called from layer 3, when a packet arrives for layer 4 
    In this practical this will always be an ACK as B never sends data.
 */
-void A_input(struct pkt packet)
+static void A_input(struct pkt packet)
 {
+    struct sender *s = sim_state(A, sizeof(struct sender));
+    unsigned int acknum = (unsigned int)packet.acknum;
+    unsigned int offset;
     int index;
-    int i;
-    int sequence;
-
-    if (!IsCorrupted(packet)) {
-        if (TRACE > 0)
-            printf("----A: uncorrupted ACK %d is received\n", packet.acknum);
-        total_ACKs_received++;
-
-        if (((sender_base <= (sender_base + WINDOWSIZE - 1) % SEQSPACE) &&
-             (packet.acknum >= sender_base && packet.acknum <= (sender_base + WINDOWSIZE - 1) % SEQSPACE)) ||
-            ((sender_base > (sender_base + WINDOWSIZE - 1) % SEQSPACE) &&
-             (packet.acknum >= sender_base || packet.acknum <= (sender_base + WINDOWSIZE - 1) % SEQSPACE))) {
-
-            index = packet.acknum % WINDOWSIZE;
-
-            if (!acked[index]) {
-                if (TRACE > 0)
-                    printf("----A: ACK %d is not a duplicate\n", packet.acknum);
-
-                new_ACKs++;
-                acked[index] = true;
-                stoptimer(A);
-
-                if (packet.acknum == sender_base) {
-                    while (acked[sender_base % WINDOWSIZE]) {
-                        acked[sender_base % WINDOWSIZE] = false;
-                        sender_base = (sender_base + 1) % SEQSPACE;
-                        windowcount--;
-                        if (windowcount == 0)
-                            break;
-                    }
-                }
+    int nacked = 0;
 
-                if (windowcount > 0) {
-                    for (i = 0; i < WINDOWSIZE; i++) {
-                        sequence = (sender_base + i) % SEQSPACE;
-                        if (sequence == A_nextseqnum)
-                            break;
-                        index = sequence % WINDOWSIZE;
-                        if (!acked[index]) {
-                            starttimer(A, RTT);
-                            break;
-                        }
-                    }
-                }
+    if (!IsCorrupted(&packet)) {
+        if (TRACING(1))
+            printf("----A: uncorrupted ACK %u is received\n", acknum);
+        sim_stats()->total_ACKs_received++;
+
+        /* place of the ACKed packet in the window, if it is there */
+        offset = acknum < s->seqspace ? seq_diff(acknum, s->sender_base, s->seqspace) : (unsigned int)s->windowcount;
+
+        if (offset < (unsigned int)s->windowcount) {
+
+            index = (int)((s->windowfirst + offset) % s->windowsize);
+
+            if (AckPacket(s, offset)) {
+                if (TRACING(1))
+                    printf("----A: ACK %u is not a duplicate\n", acknum);
+                nacked = 1;
+
+                /* time the round trip from the copy of the packet the
+                   ACK echoes, if that is known (see rto.h) */
+                if (packet.seqnum == 0)
+                    rto_sample(&s->rto, sim_time() - s->senttime[index]);
+                else if (packet.seqnum == s->buffer[index].acknum)
+                    rto_sample(&s->rto, sim_time() - s->lastsent[index]);
 
             } else {
-                if (TRACE > 0)
-                    printf("----A: duplicate or mismatched ACK %d received, do nothing!\n", packet.acknum);
+                if (TRACING(1))
+                    printf("----A: duplicate or mismatched ACK %u received, do nothing!\n", acknum);
             }
 
         } else {
-            if (TRACE > 0)
-                printf("----A: ACK %d outside current window, do nothing!\n", packet.acknum);
+            if (TRACING(1))
+                printf("----A: ACK %u outside current window, do nothing!\n", acknum);
+        }
+
+        /* the packets the receiver holds, whose own ACKs may have been lost */
+        if (s->sack)
+            nacked += AckSelective(s, &packet);
+
+        if (nacked > 0) {
+            sim_stats()->new_ACKs++;
+            cwnd_ack(&s->cwnd, nacked);
+            NoteEstimates(s);
+
+            /* slide the window past the ACKed packets at its front;
+               each packet is passed once, so this is O(1) per ACK on average */
+            while (s->windowcount > 0 && bit_test(s->acked, s->windowfirst)) {
+                s->windowfirst = (s->windowfirst + 1) % s->windowsize;
+                s->sender_base = seq_next(s->sender_base, s->seqspace);
+                s->windowcount--;
+            }
+
+            /* resend what the congestion window held back, then fill
+               the room the ACK made from the backlog */
+            ResendPending(s);
+            SendBacklog(s);
         }
 
     } else {
-        if (TRACE > 0)
+        if (TRACING(1))
             printf("----A: corrupted ACK is received, do nothing!\n");
     }
 }
     
 
-/* called when A's timer goes off */
-void A_timerinterrupt(void)
+/* called when the timer of one of A's packets goes off; a packet's
+   timer is cancelled when it is ACKed, so the packet still awaits one */
+static void A_timerinterrupt(void)
 {
-    int i;
-    int index;
-
-    if (TRACE > 0)
-        printf("----A: time out, resend packets!\n");
-
-    if (windowcount > 0)
-    {
-        for (i = 0; i < WINDOWSIZE; i++)
-        {
-            index = (sender_base + i) % SEQSPACE % WINDOWSIZE;
-
-            if (!acked[index]&&(sender_base+1)%SEQSPACE!= A_nextseqnum)
-            {
-                if (TRACE > 0)
-                    printf("----A: resending packet %d\n", buffer[index].seqnum);
-
-                tolayer3(A, buffer[index]);
-                packets_resent++;
+    struct sender *s = sim_state(A, sizeof(struct sender));
+    int index = firedtimer();
+    int offset = (index - s->windowfirst + s->windowsize) % s->windowsize;
+
+    if (TRACING(1))
+        printf("----A: time out of packet %u!\n", (unsigned int)s->buffer[index].seqnum);
+    sim_stats()->timeouts++;
+
+    /* back off and shrink the window once per round of losses, when the
+       oldest packet times out, rather than once for every packet lost in it */
+    if (index == s->windowfirst) {
+        rto_backoff(&s->rto);
+        cwnd_timeout(&s->cwnd, s->windowcount);
+        NoteEstimates(s);
+    }
 
-                starttimer(A, RTT);
-                break; /* only one packet per timer interrupt */
-            }
-        }
+    /* a packet beyond the congestion window waits for ACKs to open it,
+       so a timeout resends no more than the window allows */
+    s->timers[index] = NOTIMER;
+    if (offset >= cwnd_window(&s->cwnd)) {
+        if (TRACING(1))
+            printf("----A: outside the congestion window, resend it later\n");
+        bit_set(s->pending, index);
+        s->npending++;
     }
+    else
+        ResendPacket(s, index);
 }
+
 /* the following routine will be called once (only) before any other */
 /* entity A routines are called. You can use it to do any initialization */
-void A_init(void)
+static void A_init(void)
 {
+  struct sender *s = sim_state(A, sizeof(struct sender));
   /* initialise A's window, buffer and sequence number */
-  int i;
-  A_nextseqnum = 0;  /* A starts with seq num 0, do not change this */
-  sender_base = 0;
-  windowcount = 0;
-  for (i = 0; i < WINDOWSIZE; i++) {
-    acked[i]=true;
-    timers[i] = NOTINUSE;
-  }
+  GetWindow(&s->windowsize, &s->seqspace);
+  s->buffer = sim_alloc(s->windowsize * sizeof(struct pkt));
+  s->acked = sim_alloc(BITMAP_WORDS(s->windowsize) * sizeof(unsigned long long));
+  s->pending = sim_alloc(BITMAP_WORDS(s->windowsize) * sizeof(unsigned long long));
+  s->timers = sim_alloc(s->windowsize * sizeof(timerhandle));
+  s->timeout = sim_alloc(s->windowsize * sizeof(double));
+  s->senttime = sim_alloc(s->windowsize * sizeof(double));
+  s->lastsent = sim_alloc(s->windowsize * sizeof(double));
+  s->A_nextseqnum = 0;  /* A starts with seq num 0, do not change this */
+  s->sender_base = 0;
+  s->windowfirst = 0;
+  s->windowcount = 0;
+  s->npending = 0;
+  rto_init(&s->rto, RTT, sim_adaptiverto(1));
+  cwnd_init(&s->cwnd, s->windowsize, sim_congestion());
+  backlog_init(&s->backlog, sim_backlog());
+  s->sack = sim_sack() || sim_ackevery() > 1;
+  NoteEstimates(s);
 }
 
 /********* Receiver (B)  variables and procedures ************/
 
-static int expectedseqnum; /* the sequence number expected next by the receiver */
-static int B_nextseqnum;   /* the sequence number for the next packets sent by B */
-static int last_ack_sent;  /* to track the last ACK sent */
-static bool RECEIVED_PACKET[WINDOWSIZE]; /*tracks which individual packet has been recieved*/
-static struct pkt buffer[WINDOWSIZE];
+struct receiver {
+  unsigned int expectedseqnum; /* the sequence number expected next by the receiver */
+  int B_nextseqnum;   /* the sequence number for the next packets sent by B */
+  int last_ack_sent;  /* to track the last ACK sent */
+  struct pkt *buffer; /* ring of windowsize out-of-order packets waiting for delivery */
+  unsigned long long *received; /* bitmap over the ring: packet has been received */
+  int windowfirst;    /* ring index of the packet with sequence number expectedseqnum */
+  int windowsize;     /* receive window, the same as the send window */
+  long long seqspace; /* sequence numbers in use */
+  int sack;           /* ACKs carry a SACK payload */
+  int echo;           /* ACKs echo the copy count of their packet, see rto.h */
+  struct ackdelay ackdelay; /* ACKs held back */
+};
+
+/* fill payload with the receiver's SACK: its cumulative point and the
+   packets it holds in the rest of its window, up to SACKBITS of them */
+static void PutSack(const struct receiver *r, char payload[PAYLOADSIZE])
+{
+    int i;
+    int n = r->windowsize - 1 < SACKBITS ? r->windowsize - 1 : SACKBITS;
+
+    for (i = 0; i < 4; i++)
+        payload[i] = (char)(r->expectedseqnum >> (8 * i));
+    memset(payload + 4, 0, PAYLOADSIZE - 4);
+    for (i = 0; i < n; i++)
+        if (bit_test(r->received, (r->windowfirst + 1 + i) % r->windowsize))
+            payload[4 + i / 8] |= (char)(1 << (i % 8));
+}
 
 /* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
+static void B_input(struct pkt packet)
 {
+    struct receiver *r = sim_state(B, sizeof(struct receiver));
     struct pkt sendpkt;
+    unsigned int seqnum = (unsigned int)packet.seqnum;
+    unsigned int offset;
     int i;
     int idx;
-    int exp_window;
-    bool in_window;
-
-    if (!IsCorrupted(packet)) {
-        exp_window = (expectedseqnum + WINDOWSIZE - 1) % SEQSPACE;
+    int delivered = 0;
+    int echo = NOTINUSE;
 
-        in_window = (expectedseqnum <= exp_window && packet.seqnum >= expectedseqnum && packet.seqnum <= exp_window) ||
-                    (expectedseqnum > exp_window && (packet.seqnum >= expectedseqnum || packet.seqnum <= exp_window));
+    if (!IsCorrupted(&packet)) {
+        /* place of the packet in the receive window, if it is there */
+        offset = seqnum < r->seqspace ? seq_diff(seqnum, r->expectedseqnum, r->seqspace) : (unsigned int)r->windowsize;
 
-        if (in_window) {
-            idx = packet.seqnum % WINDOWSIZE;
+        if (offset < (unsigned int)r->windowsize) {
+            idx = (int)((r->windowfirst + offset) % r->windowsize);
 
-            if (!RECEIVED_PACKET[idx]) {
-                buffer[idx] = packet;
-                RECEIVED_PACKET[idx] = true;
-                if (TRACE > 0)
-                    printf("----B: packet %d is correctly received, send ACK!\n", packet.seqnum);
+            if (!bit_test(r->received, idx)) {
+                r->buffer[idx] = packet;
+                bit_set(r->received, idx);
+                if (TRACING(1))
+                    printf("----B: packet %u is correctly received, send ACK!\n", seqnum);
             }
 
-            if (packet.seqnum == expectedseqnum) {
-                packets_received++;
-                tolayer5(B, packet.payload);
-                RECEIVED_PACKET[idx] = false;
-                expectedseqnum = (expectedseqnum + 1) % SEQSPACE;
-
-                for (i = 0; i < WINDOWSIZE; i++) {
-                    int next_seq = (expectedseqnum + i) % SEQSPACE;
-                    int next_idx = next_seq % WINDOWSIZE;
-                    if (RECEIVED_PACKET[next_idx]) {
-                        tolayer5(B, buffer[next_idx].payload);
-                        RECEIVED_PACKET[next_idx] = false;
-                        expectedseqnum = (expectedseqnum + 1) % SEQSPACE;
-                    } else {
-                        break;
-                    }
+            if (offset == 0) {
+                sim_stats()->packets_received++;
+
+                /* deliver it and every packet buffered in order after it */
+                while (bit_test(r->received, r->windowfirst)) {
+                    tolayer5(B, r->buffer[r->windowfirst].payload);
+                    delivered++;
+                    bit_clear(r->received, r->windowfirst);
+                    r->windowfirst = (r->windowfirst + 1) % r->windowsize;
+                    r->expectedseqnum = seq_next(r->expectedseqnum, r->seqspace);
                 }
             }
 
-            last_ack_sent = packet.seqnum;
-            sendpkt.acknum = last_ack_sent;
+            r->last_ack_sent = packet.seqnum;
+            sendpkt.acknum = r->last_ack_sent;
         } else {
-            if (TRACE > 0)
+            if (TRACING(1))
                 printf("----B: packet outside receive window, send ACK!\n");
             sendpkt.acknum = packet.seqnum;
         }
+        echo = packet.acknum;
     } else {
-        if (TRACE > 0)
+        if (TRACING(1))
             printf("----B: packet corrupted or not expected sequence number, resend ACK!\n");
-        sendpkt.acknum = last_ack_sent;
+        sendpkt.acknum = r->last_ack_sent;
     }
 
-    sendpkt.seqnum = B_nextseqnum;
-    B_nextseqnum = (B_nextseqnum + 1) % 2;
-    for (i = 0; i < 20; i++)
-        sendpkt.payload[i] = '0';
-    sendpkt.checksum = ComputeChecksum(sendpkt);
-
-    tolayer3(B, sendpkt);
+    sendpkt.seqnum = r->echo ? echo : r->B_nextseqnum;
+    r->B_nextseqnum = (r->B_nextseqnum + 1) % 2;
+    if (r->sack)
+        PutSack(r, sendpkt.payload);
+    else
+        for (i = 0; i < PAYLOADSIZE; i++)
+            sendpkt.payload[i] = '0';
+    sendpkt.checksum = ComputeChecksum(&sendpkt);
+
+    /* an ACK for the next packet in order may be held back; one that
+       fills a gap goes at once, as the sender is likely resending */
+    if (delivered == 1)
+        ackdelay_inorder(&r->ackdelay, sendpkt);
+    else
+        ackdelay_now(&r->ackdelay, sendpkt);
 }
 
 /* the following routine will be called once (only) before any other */
 /* entity B routines are called. You can use it to do any initialization */
-void B_init(void)
+static void B_init(void)
 {
-  int i;
-  expectedseqnum = 0;
-  B_nextseqnum = 1;
-  last_ack_sent = SEQSPACE - 1;
-  for (i = 0; i < WINDOWSIZE; i++) 
-  {
-    RECEIVED_PACKET[i] = false;
-  }
+  struct receiver *r = sim_state(B, sizeof(struct receiver));
+  GetWindow(&r->windowsize, &r->seqspace);
+  r->buffer = sim_alloc(r->windowsize * sizeof(struct pkt));
+  r->received = sim_alloc(BITMAP_WORDS(r->windowsize) * sizeof(unsigned long long));
+  r->expectedseqnum = 0;
+  r->B_nextseqnum = 1;
+  r->last_ack_sent = (int)(unsigned int)(r->seqspace - 1);
+  r->windowfirst = 0;
+  r->sack = sim_sack() || sim_ackevery() > 1;
+  r->echo = sim_adaptiverto(1);
+  ackdelay_init(&r->ackdelay, sim_ackevery());
 }
 
 /******************************************************************************
@@ -321,12 +565,33 @@ void B_init(void)
  *****************************************************************************/
 
 /* Note that with simplex transfer from a-to-B, there is no B_output() */
-void B_output(struct msg message)
+static void B_output(struct msg message)
 {
 }
 
+static int B_ready(void)
+{
+  return 1;
+}
+
 /* called when B's timer goes off */
-void B_timerinterrupt(void)
+static void B_timerinterrupt(void)
 {
+  struct receiver *r = sim_state(B, sizeof(struct receiver));
+
+  ackdelay_timeout(&r->ackdelay);
 }
 
+const struct protocol sr_protocol = {
+  .name = "sr",
+  .A_init = A_init,
+  .B_init = B_init,
+  .A_input = A_input,
+  .B_input = B_input,
+  .A_output = A_output,
+  .A_timerinterrupt = A_timerinterrupt,
+  .B_output = B_output,
+  .B_timerinterrupt = B_timerinterrupt,
+  .A_ready = A_ready,
+  .B_ready = B_ready
+};
@@ -0,0 +1,499 @@
+/* ******************************************************************
+   Parameter sweep driver.
+
+   Runs every point of a grid of protocol x loss probability x
+   corruption probability x lambda x window size, repeating each point
+   with several seeds.  The independent
+   simulations are spread over a pool of worker threads; each worker
+   owns a deque of runs, works from its bottom end and, once it is
+   empty, steals from the top end of the others.  Results are
+   aggregated per grid point (mean and 95% confidence interval) and
+   written as CSV or JSON, with the number of the point's runs that were
+   stopped as overloaded, whose figures cover only part of the run.
+
+   Every run of a point draws each stochastic process from its own
+   stream, so runs that share a seed see the same arrivals, losses and
+   delays whatever their other parameters (common random numbers).  With
+   -a each seed is also run antithetically (every draw u becomes 1 - u)
+   and the average of the pair counts as one sample, which narrows the
+   interval when a metric is monotone in the draws.
+
+   e.g.  sweep -n 10000 -p gbn,sr -l 0,0.1,0.2 -c 0,0.1 -m 5,10 -w 2,4,6 -r 20 -o out.csv
+**********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "protocol.h"
+#include "config.h"
+#include "sim.h"
+
+#define MAXAXIS 64              /* most values on one axis of the grid */
+
+struct axis {
+  double v[MAXAXIS];
+  int n;
+};
+
+/* one simulation to run */
+struct run {
+  struct simconfig cfg;
+  struct simstats stats;        /* filled in once the run is done */
+  struct simmetrics metrics;
+};
+
+/* a worker's share of the runs; the owner takes from the bottom,
+   thieves from the top */
+struct deque {
+  pthread_mutex_t lock;
+  int *runs;
+  int top, bottom;
+};
+
+struct pool {
+  struct run *runs;
+  struct deque *deques;
+  int nworkers;
+};
+
+struct worker {
+  struct pool *pool;
+  int id;
+};
+
+/* comma-separated values of the scenario option opt, each checked by
+   config_option() just as on the emulator's command line; protocols
+   are stored as indices in protocols[] */
+static int parseaxis(struct axis *ax, const char *opt, const char *arg)
+{
+  struct simconfig cfg;
+  char buf[CONFIG_LINESIZE], *tok;
+
+  config_defaults(&cfg);
+  strncpy(buf, arg, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  ax->n = 0;
+  for (tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+    if (ax->n == MAXAXIS || config_option(&cfg, opt, tok) <= 0)
+      return -1;
+    switch (opt[1]) {
+    case 'p':
+      ax->v[ax->n] = cfg.protocol;
+      break;
+    case 'l':
+      ax->v[ax->n] = cfg.lossprob;
+      break;
+    case 'c':
+      ax->v[ax->n] = cfg.corruptprob;
+      break;
+    case 'm':
+      ax->v[ax->n] = cfg.lambda;
+      break;
+    default:
+      ax->v[ax->n] = cfg.windowsize;
+      break;
+    }
+    ax->n++;
+  }
+  return ax->n > 0 ? 0 : -1;
+}
+
+/********************* WORK-STEALING POOL *************/
+
+static int popbottom(struct deque *d)
+{
+  int r = -1;
+
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top)
+    r = d->runs[--d->bottom];
+  pthread_mutex_unlock(&d->lock);
+  return r;
+}
+
+static int steal(struct deque *d)
+{
+  int r = -1;
+
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top)
+    r = d->runs[d->top++];
+  pthread_mutex_unlock(&d->lock);
+  return r;
+}
+
+static void *workermain(void *arg)
+{
+  struct worker *w = arg;
+  struct pool *p = w->pool;
+  struct sim *s;
+  int r, i;
+
+  for (;;) {
+    r = popbottom(&p->deques[w->id]);
+    for (i = 1; r < 0 && i < p->nworkers; i++)
+      r = steal(&p->deques[(w->id + i) % p->nworkers]);
+    if (r < 0)
+      break;              /* no work left anywhere: runs never create more */
+
+    s = sim_create(&p->runs[r].cfg);
+    sim_run(s);
+    p->runs[r].stats = *sim_getstats(s);
+    sim_getmetrics(s, &p->runs[r].metrics);
+    sim_destroy(s);
+  }
+  return NULL;
+}
+
+static void runpool(struct run *runs, int nruns, int nworkers)
+{
+  struct pool p;
+  struct worker *workers;
+  pthread_t *threads;
+  int i, j, first, last;
+
+  p.runs = runs;
+  p.nworkers = nworkers;
+  p.deques = calloc(nworkers, sizeof(struct deque));
+  workers = calloc(nworkers, sizeof(struct worker));
+  threads = calloc(nworkers, sizeof(pthread_t));
+  if (p.deques == NULL || workers == NULL || threads == NULL) {
+    fprintf(stderr, "memory allocation for worker pool failed.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* deal the runs out in contiguous blocks, one block per worker */
+  for (i = 0; i < nworkers; i++) {
+    first = (int)((long long)nruns * i / nworkers);
+    last = (int)((long long)nruns * (i + 1) / nworkers);
+    pthread_mutex_init(&p.deques[i].lock, NULL);
+    p.deques[i].runs = malloc((last - first + 1) * sizeof(int));
+    if (p.deques[i].runs == NULL) {
+      fprintf(stderr, "memory allocation for worker pool failed.\n");
+      exit(EXIT_FAILURE);
+    }
+    p.deques[i].top = 0;
+    p.deques[i].bottom = 0;
+    for (j = first; j < last; j++)
+      p.deques[i].runs[p.deques[i].bottom++] = j;
+  }
+
+  for (i = 0; i < nworkers; i++) {
+    workers[i].pool = &p;
+    workers[i].id = i;
+    if (pthread_create(&threads[i], NULL, workermain, &workers[i]) != 0) {
+      fprintf(stderr, "unable to start worker thread.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (i = 0; i < nworkers; i++)
+    pthread_join(threads[i], NULL);
+
+  for (i = 0; i < nworkers; i++) {
+    pthread_mutex_destroy(&p.deques[i].lock);
+    free(p.deques[i].runs);
+  }
+  free(p.deques);
+  free(workers);
+  free(threads);
+}
+
+/********************* AGGREGATION ********************/
+
+/* mean and half-width of the 95% confidence interval of a sample */
+struct estimate {
+  double mean;
+  double ci95;
+};
+
+/* two-sided 95% quantiles of Student's t for 1..30 degrees of freedom */
+static const double tquantile[31] = {
+  0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+  2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+  2.042
+};
+
+static struct estimate estimate(const double *x, int n)
+{
+  struct estimate e;
+  double sum = 0.0, ss = 0.0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    sum += x[i];
+  e.mean = n > 0 ? sum / n : 0.0;
+  e.ci95 = 0.0;
+  if (n > 1) {
+    for (i = 0; i < n; i++)
+      ss += (x[i] - e.mean) * (x[i] - e.mean);
+    e.ci95 = (n - 1 <= 30 ? tquantile[n - 1] : 1.96) * sqrt(ss / (n - 1) / n);
+  }
+  return e;
+}
+
+#define NMETRICS 6
+
+static const char *metricname[NMETRICS] = {
+  "delivered", "resent", "window_full", "goodput", "latency_p50", "latency_p99"
+};
+
+static double metric(const struct run *r, int m)
+{
+  switch (m) {
+  case 0:
+    return r->stats.messages_delivered;
+  case 1:
+    return r->stats.packets_resent;
+  case 2:
+    return r->stats.window_full;
+  case 3:
+    return r->metrics.goodput;
+  case 4:
+    return r->metrics.latency_p50;
+  default:
+    return r->metrics.latency_p99;
+  }
+}
+
+/* noverloaded of the point's runs were stopped because the channel
+   could no longer drain, so their figures cover only part of the run */
+static void writepoint(FILE *fp, int json, int first, const struct simconfig *cfg,
+                       int nruns, int noverloaded, const struct estimate *e)
+{
+  int m;
+
+  if (json) {
+    fprintf(fp, "%s  {\"protocol\": \"%s\", \"loss\": %g, \"corrupt\": %g, \"lambda\": %g, "
+            "\"window\": %d, \"runs\": %d, \"overloaded\": %d", first ? "" : ",\n",
+            protocols[cfg->protocol]->name, cfg->lossprob, cfg->corruptprob, cfg->lambda,
+            cfg->windowsize, nruns, noverloaded);
+    for (m = 0; m < NMETRICS; m++)
+      fprintf(fp, ", \"%s_mean\": %g, \"%s_ci95\": %g",
+              metricname[m], e[m].mean, metricname[m], e[m].ci95);
+    fprintf(fp, "}");
+  }
+  else {
+    fprintf(fp, "%s,%g,%g,%g,%d,%d,%d", protocols[cfg->protocol]->name, cfg->lossprob,
+            cfg->corruptprob, cfg->lambda, cfg->windowsize, nruns, noverloaded);
+    for (m = 0; m < NMETRICS; m++)
+      fprintf(fp, ",%g,%g", e[m].mean, e[m].ci95);
+    fprintf(fp, "\n");
+  }
+}
+
+/* nper runs per seed: 1, or 2 for a plain and an antithetic run */
+static void writeresults(FILE *fp, int json, const struct run *runs, int npoints, int nseeds,
+                         int nper)
+{
+  struct estimate e[NMETRICS];
+  double *x;
+  const struct run *pt;
+  int p, m, k, j;
+  int noverloaded;
+
+  x = malloc(nseeds * sizeof(double));
+  if (x == NULL) {
+    fprintf(stderr, "memory allocation for results failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (json)
+    fprintf(fp, "[\n");
+  else {
+    fprintf(fp, "protocol,loss,corrupt,lambda,window,runs,overloaded");
+    for (m = 0; m < NMETRICS; m++)
+      fprintf(fp, ",%s_mean,%s_ci95", metricname[m], metricname[m]);
+    fprintf(fp, "\n");
+  }
+  /* the runs of grid point p are runs[p*nseeds*nper ..], those of seed k
+     of the point pt[k*nper .. k*nper+nper-1] */
+  for (p = 0; p < npoints; p++) {
+    pt = &runs[p * nseeds * nper];
+    noverloaded = 0;
+    for (k = 0; k < nseeds * nper; k++)
+      noverloaded += pt[k].stats.overloaded;
+    for (m = 0; m < NMETRICS; m++) {
+      for (k = 0; k < nseeds; k++) {
+        x[k] = 0.0;
+        for (j = 0; j < nper; j++)
+          x[k] += metric(&pt[k * nper + j], m);
+        x[k] /= nper;
+      }
+      e[m] = estimate(x, nseeds);
+    }
+    writepoint(fp, json, p == 0, &pt[0].cfg, nseeds, noverloaded, e);
+  }
+  if (json)
+    fprintf(fp, "\n]\n");
+  free(x);
+}
+
+/********************* MAIN ***************************/
+
+static void usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [options]\n", progname);
+  fprintf(stderr, "grid axes (comma-separated lists of values):\n");
+  fprintf(stderr, "  -p names   protocols: gbn, sr (default gbn)\n");
+  fprintf(stderr, "  -l probs   packet loss probabilities (default 0)\n");
+  fprintf(stderr, "  -c probs   packet corruption probabilities (default 0)\n");
+  fprintf(stderr, "  -m times   average times between messages (default 10)\n");
+  fprintf(stderr, "  -w sizes   sender window sizes (default: the protocol's own)\n");
+  fprintf(stderr, "other options:\n");
+  fprintf(stderr, "  -n count   number of messages per run (default 1000)\n");
+  fprintf(stderr, "  -d dir     loss/corruption direction: 0 A->B, 1 A<-B, 2 both\n");
+  fprintf(stderr, "  -S space   sequence numbers in use (default: the protocol's own)\n");
+  fprintf(stderr, "  -D count   fast retransmit after count duplicate ACKs (GBN; default 0, none)\n");
+  fprintf(stderr, "  -R 0|1     adaptive retransmission timeout (default: 1 for SR, 0 for GBN)\n");
+  fprintf(stderr, "  -C 0|1     congestion control (default 0, fixed window)\n");
+  fprintf(stderr, "  -B size    sender backlog of messages waiting for the window (default 0;\n");
+  fprintf(stderr, "             use with -R 1, or a run may stop with the channel overloaded)\n");
+  fprintf(stderr, "  -K 0|1     selective acknowledgements (SR; default 0, one packet per ACK)\n");
+  fprintf(stderr, "  -A count   delayed ACKs, one per count packets in order (default 1;\n");
+  fprintf(stderr, "             turns on -R 1 unless -R 0 is given)\n");
+  fprintf(stderr, "  -e name    packet checksum: sum, inet, fletcher, adler, crc32c (default sum)\n");
+  fprintf(stderr, "  -M bytes   segmented messages of this size (default 0, one per packet)\n");
+  fprintf(stderr, "  -U bytes   payload bytes per packet for segmented messages (default: all)\n");
+  fprintf(stderr, "  -r count   seeds (runs) per grid point (default 10)\n");
+  fprintf(stderr, "  -s seed    first seed; run k of a point uses seed+k (default 1)\n");
+  fprintf(stderr, "  -g gen     random number generator: xoshiro (default) or rand\n");
+  fprintf(stderr, "  -a         pair every run with an antithetic one\n");
+  fprintf(stderr, "  -j count   worker threads (default: one per online CPU)\n");
+  fprintf(stderr, "  -o file    write the results to file instead of stdout\n");
+  fprintf(stderr, "  -J         write JSON instead of CSV\n");
+}
+
+int main(int argc, char **argv)
+{
+  struct axis proto, loss, corrupt, lambda, window;
+  struct simconfig base;
+  struct run *runs;
+  FILE *fp = stdout;
+  const char *outname = NULL;
+  int nseeds = 10, nworkers = 0, json = 0, nper = 1;
+  int npoints, nruns, i, a, b, c, d, e, k, j, r, err;
+
+  config_defaults(&base);
+  base.seed = 1;
+  parseaxis(&proto, "-p", "gbn");
+  parseaxis(&loss, "-l", "0");
+  parseaxis(&corrupt, "-c", "0");
+  parseaxis(&lambda, "-m", "10");
+  parseaxis(&window, "-w", "0");
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-J") == 0) {
+      json = 1;
+      continue;
+    }
+    if (strcmp(argv[i], "-a") == 0) {
+      nper = 2;
+      continue;
+    }
+    if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 >= argc) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    switch (argv[i][1]) {
+    case 'p':
+      err = parseaxis(&proto, argv[i], argv[i + 1]);
+      break;
+    case 'l':
+      err = parseaxis(&loss, argv[i], argv[i + 1]);
+      break;
+    case 'c':
+      err = parseaxis(&corrupt, argv[i], argv[i + 1]);
+      break;
+    case 'm':
+      err = parseaxis(&lambda, argv[i], argv[i + 1]);
+      break;
+    case 'w':
+      err = parseaxis(&window, argv[i], argv[i + 1]);
+      break;
+    case 'n':
+    case 'd':
+    case 's':
+    case 'S':
+    case 'D':
+    case 'R':
+    case 'C':
+    case 'B':
+    case 'K':
+    case 'A':
+    case 'e':
+    case 'M':
+    case 'U':
+    case 'g':
+      err = config_option(&base, argv[i], argv[i + 1]) > 0 ? 0 : -1;
+      break;
+    case 'r':
+      nseeds = atoi(argv[i + 1]);
+      err = nseeds > 0 ? 0 : -1;
+      break;
+    case 'j':
+      nworkers = atoi(argv[i + 1]);
+      err = nworkers > 0 ? 0 : -1;
+      break;
+    case 'o':
+      outname = argv[i + 1];
+      err = 0;
+      break;
+    default:
+      err = -1;
+      break;
+    }
+    if (err) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    i++;
+  }
+  if (nworkers == 0) {
+    nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nworkers < 1)
+      nworkers = 1;
+  }
+
+  npoints = proto.n * loss.n * corrupt.n * lambda.n * window.n;
+  nruns = npoints * nseeds * nper;
+  runs = calloc(nruns, sizeof(struct run));
+  if (runs == NULL) {
+    fprintf(stderr, "memory allocation for runs failed.\n");
+    return EXIT_FAILURE;
+  }
+  r = 0;
+  for (e = 0; e < proto.n; e++)
+    for (a = 0; a < loss.n; a++)
+      for (b = 0; b < corrupt.n; b++)
+        for (c = 0; c < lambda.n; c++)
+          for (d = 0; d < window.n; d++)
+            for (k = 0; k < nseeds; k++)
+              for (j = 0; j < nper; j++, r++) {
+                runs[r].cfg = base;
+                runs[r].cfg.protocol = (int)proto.v[e];
+                runs[r].cfg.lossprob = loss.v[a];
+                runs[r].cfg.corruptprob = corrupt.v[b];
+                runs[r].cfg.lambda = lambda.v[c];
+                runs[r].cfg.windowsize = (int)window.v[d];
+                runs[r].cfg.seed = base.seed + k;
+                runs[r].cfg.antithetic = j;
+              }
+
+  runpool(runs, nruns, nworkers);
+
+  if (outname != NULL) {
+    fp = fopen(outname, "w");
+    if (fp == NULL) {
+      perror(outname);
+      return EXIT_FAILURE;
+    }
+  }
+  writeresults(fp, json, runs, npoints, nseeds, nper);
+  if (fp != stdout)
+    fclose(fp);
+  free(runs);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,338 @@
+/* ******************************************************************
+   Offline analysis of a binary event trace (see bintrace.h).
+
+   The trace is memory-mapped, so even traces of very long runs are
+   read without copying.  By default the tool prints summary statistics;
+   it can also list the timeline of every packet, of one packet or of
+   every packet carrying one sequence number, or dump each record as
+   text.  A packet the protocol counted as a resend is linked to the
+   earlier sends of its sequence number by the same entity.
+
+   e.g.  emulator -p gbn -n 100000 -l 0.1 -b run.trace -q
+         tracetool run.trace
+         tracetool -p 42 run.trace
+**********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bintrace.h"
+
+struct trace {
+  const struct btrecord *rec;
+  long long nrecs;
+  void *map;
+  size_t mapsize;
+};
+
+/* per-packet view: the send record and, unless it was lost, the arrival */
+struct packet {
+  const struct btrecord *send;
+  const struct btrecord *arrive;
+  long long first;        /* packet that first carried this seq, before any resends */
+  int attempt;            /* 1 for a first send, 2 for its first resend, ... */
+};
+
+static const char *entityname[2] = { "A", "B" };
+
+static int opentrace(struct trace *t, const char *path)
+{
+  const struct btheader *h;
+  struct stat st;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    perror(path);
+    return -1;
+  }
+  if ((size_t)st.st_size < sizeof(struct btheader)) {
+    fprintf(stderr, "%s: not a binary trace\n", path);
+    close(fd);
+    return -1;
+  }
+  t->mapsize = st.st_size;
+  t->map = mmap(NULL, t->mapsize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (t->map == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+  h = t->map;
+  if (memcmp(h->magic, BT_MAGIC, sizeof(h->magic)) != 0 || h->version != BT_VERSION ||
+      h->recsize != sizeof(struct btrecord)) {
+    fprintf(stderr, "%s: not a version %d binary trace written on this kind of machine\n",
+            path, BT_VERSION);
+    munmap(t->map, t->mapsize);
+    return -1;
+  }
+  t->rec = (const struct btrecord *)(h + 1);
+  t->nrecs = (t->mapsize - sizeof(struct btheader)) / sizeof(struct btrecord);
+  return 0;
+}
+
+/* slot of a table of size entries (a power of two) that holds the
+   latest packet sent by entity with seqnum seq, or 0 if there is none */
+static long long *seqslot(long long *table, long long size, const struct packet *pkts,
+                          int entity, int seq)
+{
+  unsigned long long h = ((unsigned int)seq * 2ULL + entity) * 0x9E3779B97F4A7C15ULL;
+  long long i = (long long)((h ^ (h >> 32)) & (size - 1));
+  const struct btrecord *s;
+
+  while (table[i] != 0) {
+    s = pkts[table[i]].send;
+    if (s->seq == seq && (s->entity & 1) == entity)
+      break;
+    i = (i + 1) & (size - 1);
+  }
+  return &table[i];
+}
+
+/* index the records by packet number, and link every resend to the
+   earlier sends of its seq by the same entity; returns the number of
+   packets */
+static long long indexpackets(const struct trace *t, struct packet **pkts)
+{
+  struct packet *p;
+  const struct btrecord *r;
+  long long i, id, prev, *last, *table, size = 2, npkts = 0;
+
+  for (i = 0; i < t->nrecs; i++)
+    if (t->rec[i].type == BT_SEND && t->rec[i].pktid > npkts)
+      npkts = t->rec[i].pktid;
+  while (size < 2 * npkts)
+    size *= 2;
+  p = calloc(npkts + 1, sizeof(struct packet));
+  table = calloc(size, sizeof(long long));
+  if (p == NULL || table == NULL) {
+    fprintf(stderr, "memory allocation for packet index failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < t->nrecs; i++) {
+    r = &t->rec[i];
+    id = r->pktid;
+    if (r->type == BT_SEND && id >= 1) {
+      last = seqslot(table, size, p, r->entity & 1, r->seq);
+      prev = *last;
+      p[id].send = r;
+      p[id].first = prev != 0 && (r->flags & BTF_RETRANSMIT) ? p[prev].first : id;
+      p[id].attempt = prev != 0 && (r->flags & BTF_RETRANSMIT) ? p[prev].attempt + 1 : 1;
+      *last = id;
+    }
+    else if (r->type == BT_ARRIVE && id >= 1 && id <= npkts)
+      p[id].arrive = r;
+  }
+  free(table);
+  *pkts = p;
+  return npkts;
+}
+
+static void printflags(int flags)
+{
+  if (flags & BTF_LOST)
+    printf(" lost");
+  if (flags & BTF_CORRUPT)
+    printf(" corrupt");
+  if (flags & BTF_RETRANSMIT)
+    printf(" retransmit");
+  if (flags & BTF_REFUSED)
+    printf(" refused");
+}
+
+static void printpacket(long long id, const struct packet *p)
+{
+  const struct btrecord *s = p->send;
+
+  printf("pkt %lld %s->%s seq %d ack %d sent %f", id, entityname[s->entity & 1],
+         entityname[(s->entity + 1) & 1], s->seq, s->ack, s->time);
+  if (p->arrive != NULL)
+    printf(" arrived %f delay %f", p->arrive->time, p->arrive->time - s->time);
+  printflags(s->flags);
+  if (p->attempt > 1)
+    printf(" (attempt %d, first sent as pkt %lld)", p->attempt, p->first);
+  printf("\n");
+}
+
+static void dump(const struct trace *t)
+{
+  static const char *typename[] = { "?", "message", "send", "arrive", "deliver", "timeout" };
+  const struct btrecord *r;
+  long long i;
+
+  for (i = 0; i < t->nrecs; i++) {
+    r = &t->rec[i];
+    printf("%f %s %s", r->time, r->type <= BT_TIMEOUT ? typename[r->type] : "?",
+           entityname[r->entity & 1]);
+    if (r->type == BT_MESSAGE)
+      printf(" msg %lld", r->pktid);
+    else if (r->type == BT_SEND || r->type == BT_ARRIVE)
+      printf(" pkt %lld seq %d ack %d", r->pktid, r->seq, r->ack);
+    else if (r->type == BT_TIMEOUT)
+      printf(" tag %d", r->seq);
+    printflags(r->flags);
+    printf("\n");
+  }
+}
+
+static void summary(const struct trace *t, const struct packet *pkts, long long npkts)
+{
+  long long nmsg[2] = { 0, 0 }, nrefused[2] = { 0, 0 }, ndeliver[2] = { 0, 0 };
+  long long nsend[2] = { 0, 0 }, nlost[2] = { 0, 0 }, ncorrupt[2] = { 0, 0 };
+  long long nresent[2] = { 0, 0 }, narrive[2] = { 0, 0 }, ntimeout[2] = { 0, 0 };
+  double delaysum[2] = { 0, 0 }, delaymax[2] = { 0, 0 };
+  double latsum[2] = { 0, 0 }, latmax[2] = { 0, 0 };
+  double *accepted[2], d;
+  long long i, nlat[2] = { 0, 0 }, nbackward = 0;
+  const struct btrecord *r;
+  int e;
+
+  /* messages are delivered in the order they were accepted, so the k-th
+     delivery at one entity is the k-th message accepted by the other */
+  for (i = 0; i < t->nrecs; i++)
+    if (t->rec[i].type == BT_MESSAGE)
+      nmsg[t->rec[i].entity & 1]++;
+  for (e = 0; e < 2; e++) {
+    accepted[e] = malloc((nmsg[e] + 1) * sizeof(double));
+    if (accepted[e] == NULL) {
+      fprintf(stderr, "memory allocation for latencies failed.\n");
+      exit(EXIT_FAILURE);
+    }
+    nmsg[e] = 0;
+  }
+  for (i = 0; i < t->nrecs; i++) {
+    r = &t->rec[i];
+    e = r->entity & 1;
+    /* records are written in simulation order, so time never decreases */
+    if (i > 0 && r->time < t->rec[i - 1].time)
+      nbackward++;
+    switch (r->type) {
+    case BT_MESSAGE:
+      if (r->flags & BTF_REFUSED)
+        nrefused[e]++;
+      else
+        accepted[e][nmsg[e] - nrefused[e]] = r->time;
+      nmsg[e]++;
+      break;
+    case BT_SEND:
+      nsend[e]++;
+      nlost[e] += (r->flags & BTF_LOST) != 0;
+      ncorrupt[e] += (r->flags & BTF_CORRUPT) != 0;
+      nresent[e] += (r->flags & BTF_RETRANSMIT) != 0;
+      break;
+    case BT_ARRIVE:
+      narrive[e]++;
+      if (r->pktid >= 1 && r->pktid <= npkts && pkts[r->pktid].send != NULL) {
+        d = r->time - pkts[r->pktid].send->time;
+        delaysum[e] += d;
+        if (d > delaymax[e])
+          delaymax[e] = d;
+      }
+      break;
+    case BT_DELIVER:
+      if (ndeliver[e] < nmsg[!e] - nrefused[!e]) {
+        d = r->time - accepted[!e][ndeliver[e]];
+        latsum[e] += d;
+        if (d > latmax[e])
+          latmax[e] = d;
+        nlat[e]++;
+      }
+      ndeliver[e]++;
+      break;
+    case BT_TIMEOUT:
+      ntimeout[e]++;
+      break;
+    }
+  }
+
+  printf("records: %lld, last event at time %f, %lld out of time order\n", t->nrecs,
+         t->nrecs > 0 ? t->rec[t->nrecs - 1].time : 0.0, nbackward);
+  for (e = 0; e < 2; e++) {
+    if (nmsg[e] == 0 && nsend[e] == 0 && narrive[e] == 0 && ndeliver[e] == 0)
+      continue;
+    printf("entity %s:\n", entityname[e]);
+    printf("  messages from layer 5: %lld, refused (window or segment queue full): %lld\n", nmsg[e], nrefused[e]);
+    printf("  packets sent: %lld, retransmitted: %lld, lost: %lld, corrupted: %lld\n",
+           nsend[e], nresent[e], nlost[e], ncorrupt[e]);
+    printf("  packets arrived: %lld, one-way delay mean %f max %f\n", narrive[e],
+           narrive[e] > 0 ? delaysum[e] / narrive[e] : 0.0, delaymax[e]);
+    printf("  messages delivered to layer 5: %lld, latency mean %f max %f\n", ndeliver[e],
+           nlat[e] > 0 ? latsum[e] / nlat[e] : 0.0, latmax[e]);
+    printf("  timeouts: %lld\n", ntimeout[e]);
+  }
+  free(accepted[0]);
+  free(accepted[1]);
+}
+
+static void usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [-d | -t | -p id | -s seq] tracefile\n", progname);
+  fprintf(stderr, "  (none)     summary statistics\n");
+  fprintf(stderr, "  -d         dump every record as text\n");
+  fprintf(stderr, "  -t         timeline of every packet\n");
+  fprintf(stderr, "  -p id      timeline of packet id\n");
+  fprintf(stderr, "  -s seq     timeline of every packet with seqnum seq, resends linked\n");
+}
+
+int main(int argc, char **argv)
+{
+  struct trace t;
+  struct packet *pkts;
+  long long npkts, id = 0, i;
+  int mode = 'S', seq = 0, found;
+
+  if (argc == 3 && (strcmp(argv[1], "-d") == 0 || strcmp(argv[1], "-t") == 0))
+    mode = argv[1][1];
+  else if (argc == 4 && strcmp(argv[1], "-p") == 0) {
+    mode = 'p';
+    id = atoll(argv[2]);
+  }
+  else if (argc == 4 && strcmp(argv[1], "-s") == 0) {
+    mode = 's';
+    seq = atoi(argv[2]);
+  }
+  else if (argc != 2 || argv[1][0] == '-') {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (opentrace(&t, argv[argc - 1]) < 0)
+    return EXIT_FAILURE;
+
+  if (mode == 'd')
+    dump(&t);
+  else {
+    npkts = indexpackets(&t, &pkts);
+    if (mode == 't') {
+      for (i = 1; i <= npkts; i++)
+        if (pkts[i].send != NULL)
+          printpacket(i, &pkts[i]);
+    }
+    else if (mode == 'p') {
+      if (id < 1 || id > npkts || pkts[id].send == NULL) {
+        fprintf(stderr, "no packet %lld in the trace\n", id);
+        return EXIT_FAILURE;
+      }
+      printpacket(id, &pkts[id]);
+    }
+    else if (mode == 's') {
+      found = 0;
+      for (i = 1; i <= npkts; i++)
+        if (pkts[i].send != NULL && pkts[i].send->seq == seq) {
+          printpacket(i, &pkts[i]);
+          found = 1;
+        }
+      if (!found) {
+        fprintf(stderr, "no packet with seq %d in the trace\n", seq);
+        return EXIT_FAILURE;
+      }
+    }
+    else
+      summary(&t, pkts, npkts);
+    free(pkts);
+  }
+  munmap(t.map, t.mapsize);
+  return EXIT_SUCCESS;
+}
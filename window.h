@@ -0,0 +1,45 @@
+/* ******************************************************************
+   Sequence numbers and per-packet flags for sliding windows.
+
+   Sequence numbers run from 0 to seqspace - 1 and wrap; seqspace is
+   anything from 2 up to SEQSPACE32, the full 32-bit space.  Two numbers
+   are compared by their serial distance, (a - b) mod seqspace, which
+   stays correct across the wrap as long as the numbers compared are
+   less than half the space apart (RFC 1982).
+
+   A window of n packets keeps one bit per packet in a bitmap of
+   BITMAP_WORDS(n) words, indexed by the packet's place in the window's
+   ring buffer.
+**********************************************************************/
+
+#define SEQSPACE32 4294967296LL   /* every value of a 32-bit sequence number */
+
+/* sequence number following seq */
+static inline unsigned int seq_next(unsigned int seq, long long seqspace)
+{
+  return (unsigned int)((seq + 1ULL) % (unsigned long long)seqspace);
+}
+
+/* serial distance from b forward to a, both below seqspace */
+static inline unsigned int seq_diff(unsigned int a, unsigned int b, long long seqspace)
+{
+  return (unsigned int)(a >= b ? a - b : a + (unsigned long long)seqspace - b);
+}
+
+#define BITMAP_WORDBITS 64
+#define BITMAP_WORDS(n) (((n) + BITMAP_WORDBITS - 1) / BITMAP_WORDBITS)
+
+static inline int bit_test(const unsigned long long *map, int i)
+{
+  return (map[i / BITMAP_WORDBITS] >> (i % BITMAP_WORDBITS)) & 1;
+}
+
+static inline void bit_set(unsigned long long *map, int i)
+{
+  map[i / BITMAP_WORDBITS] |= 1ULL << (i % BITMAP_WORDBITS);
+}
+
+static inline void bit_clear(unsigned long long *map, int i)
+{
+  map[i / BITMAP_WORDBITS] &= ~(1ULL << (i % BITMAP_WORDBITS));
+}